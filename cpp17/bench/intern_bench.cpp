@@ -0,0 +1,456 @@
+//	intern_bench.cpp
+//
+//	Benchmarks for intern.hpp. There is no build script, so compile it any
+//	way you like, e.g. from this directory:
+//
+//		g++ -std=c++17 -O2 -pthread -I../headers intern_bench.cpp -o intern_bench
+//
+//	and run it as:
+//
+//		./intern_bench [filter] [-t max-threads] [-r reps]
+//
+//	Every combination of case, object type, policy, and reference type is run
+//	(or just those whose "case/type/policy/ref" name contains filter). Each
+//	line of output gives the best of reps timed runs (5 by default), after an
+//	untimed warm-up run. Keys are generated from fixed seeds, so every run
+//	does exactly the same work, and results can be compared from one build
+//	(or policy) to the next. Thread counts go up in powers of 2 to max-
+//	threads (the hardware concurrency by default).
+//
+//	The cases are:
+//
+//	hit:
+//		Each thread interns kOps objects drawn from kHot unique values, all
+//		of which are kept alive throughout, so every call finds an existing
+//		object. Like the next two cases, this is reported in nanoseconds per
+//		call per thread (i.e. the wall time divided by kOps).
+//	miss:
+//		Each thread interns kOps values no other call uses, dropping each
+//		reference right away, so every call inserts an object and erases it
+//		again.
+//	storm:
+//		Each thread interns kOps unique values and holds on to them. The
+//		timed part is releasing them all at once, so most of the cost lies
+//		in erasing entries (through Deleter for shared pointers).
+//	memory:
+//		Interns kOps unique values on one thread and reports the bytes
+//		allocated per object (counted by replacing the global operator new).
+//		This includes the table's own overhead, any shared_ptr control block,
+//		and whatever the object allocates itself (e.g. a string's buffer).
+//		Only run once, since it does not depend on timing.
+
+#include "intern/intern.hpp"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <string>
+#include <thread>
+#include <vector>
+
+//---- Allocation Counting -----------------------------------------------------
+
+namespace {
+	std::atomic<std::size_t> gAllocated{0};
+}
+
+//	(GCC cannot see that these operators pair malloc with free.)
+#if defined(__GNUC__) && !defined(__clang__)
+	#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+#endif
+
+void* operator new(std::size_t size) {
+	gAllocated.fetch_add(size, std::memory_order_relaxed);
+	if(auto p = std::malloc(size ? size : 1)) {
+		return p;
+	}
+	throw std::bad_alloc{};
+}
+void operator delete(void* p) noexcept {
+	std::free(p);
+}
+void operator delete(void* p, std::size_t) noexcept {
+	std::free(p);
+}
+void* operator new(std::size_t size, std::align_val_t align) {
+	auto a = static_cast<std::size_t>(align);
+	gAllocated.fetch_add(size, std::memory_order_relaxed);
+	if(auto p = std::aligned_alloc(a, (size + a - 1) / a * a)) {
+		return p;
+	}
+	throw std::bad_alloc{};
+}
+void operator delete(void* p, std::align_val_t) noexcept {
+	std::free(p);
+}
+void operator delete(void* p, std::size_t, std::align_val_t) noexcept {
+	std::free(p);
+}
+
+namespace {
+
+	//---- Object Types --------------------------------------------------------
+	//
+	//	Color is the README's example: a small struct with a float array
+	//	Tuple. Big is a 256-byte struct whose Tuple is bytewise and returned
+	//	by reference, so it is hashed and compared in place.
+
+	struct Color {
+		using Array = std::array<float,3>;
+		float r, g, b;
+		explicit operator Array() const { return Array{r, g, b}; }
+	};
+
+	struct Big {
+		using Words = std::array<std::uint64_t,32>;
+		Words words;
+		operator const Words&() const { return words; }
+	};
+
+	//	SplitMix64 is used to generate keys, as it gives the same sequence
+	//	on every platform (unlike the standard distributions).
+	auto SplitMix(std::uint64_t n) -> std::uint64_t {
+		n += 0x9e3779b97f4a7c15;
+		n = (n ^ (n >> 30)) * 0xbf58476d1ce4e5b9;
+		n = (n ^ (n >> 27)) * 0x94d049bb133111eb;
+		return n ^ (n >> 31);
+	}
+
+	//	Each Type supplies a name, the Tuple to intern with, and Key(n),
+	//	which returns the nth distinct value.
+	template<typename T> struct Type;
+	template<> struct Type<std::string> {
+		using Tuple = void;
+		static constexpr const char* kName = "string";
+		static auto Key(std::uint64_t n) -> std::string {
+			return "key:" + std::to_string(SplitMix(n) % 1000000007u) + ':' +
+				std::to_string(n);
+		}
+	};
+	template<> struct Type<Color> {
+		using Tuple = Color::Array;
+		static constexpr const char* kName = "color";
+		static auto Key(std::uint64_t n) -> Color {
+			return Color{
+				static_cast<float>(n % 1024u) / 1023.0f,
+				static_cast<float>(n / 1024u % 1024u) / 1023.0f,
+				static_cast<float>(n / 1048576u) / 1023.0f
+				};
+		}
+	};
+	template<> struct Type<Big> {
+		using Tuple = Big::Words;
+		static constexpr const char* kName = "big";
+		static auto Key(std::uint64_t n) -> Big {
+			Big big;
+			big.words[0] = n;
+			for(std::size_t i = 1; i < big.words.size(); ++i) {
+				big.words[i] = SplitMix(n * 32u + i);
+			}
+			return big;
+		}
+	};
+
+	//---- Policies ------------------------------------------------------------
+
+	namespace policy = intern::policy;
+
+	template<typename P> struct Policy;
+	template<> struct Policy<policy::Default> {
+		static constexpr const char* kName = "default";
+	};
+	template<> struct Policy<policy::Sharded<16>> {
+		static constexpr const char* kName = "sharded16";
+	};
+	template<> struct Policy<policy::LockFreeReads<policy::Sharded<16>>> {
+		static constexpr const char* kName = "lockfree16";
+	};
+	template<> struct Policy<policy::FlatTable<policy::Sharded<16>>> {
+		static constexpr const char* kName = "flat16";
+	};
+	template<> struct Policy<policy::PooledNodes<policy::Sharded<16>>> {
+		static constexpr const char* kName = "pooled16";
+	};
+	template<> struct Policy<policy::DeferredErase<1024,policy::Sharded<16>>> {
+		static constexpr const char* kName = "deferred16";
+	};
+	template<> struct Policy<policy::ThreadCache<64,policy::Sharded<16>>> {
+		static constexpr const char* kName = "cached16";
+	};
+
+	//---- Harness -------------------------------------------------------------
+
+	constexpr std::size_t kOps = 100000;
+	constexpr std::size_t kHot = 1024;
+
+	struct Options {
+		const char* filter = "";
+		unsigned maxThreads = 1;
+		int reps = 5;
+	};
+
+	//	Ref<kHandle> picks MakeInterned() or MakeHandle().
+	template<bool kHandle> struct Ref {
+		static constexpr const char* kName = kHandle ? "handle" : "shared";
+
+		template<typename T, typename P>
+			static auto Make(const T& v) {
+				using Tuple = typename Type<T>::Tuple;
+				if constexpr(kHandle) {
+					return intern::MakeHandle<T,Tuple,P>(v);
+				}
+				else {
+					return intern::MakeInterned<T,Tuple,P>(v);
+				}
+			}
+	};
+
+	//	RunThreads() calls setUp(t) for threads t in [0, n) (untimed), then
+	//	work(t) on n threads at once, and returns the wall time of the
+	//	latter in nanoseconds.
+	template<typename SetUp, typename Work>
+		auto RunThreads(unsigned n, SetUp&& setUp, Work&& work) -> double {
+			for(unsigned t = 0; t < n; ++t) {
+				setUp(t);
+			}
+			std::atomic<unsigned> ready{0};
+			std::atomic<bool> go{false};
+			std::vector<std::thread> threads;
+			for(unsigned t = 0; t < n; ++t) {
+				threads.emplace_back([&, t] {
+					++ready;
+					while(!go.load(std::memory_order_acquire)) {
+						std::this_thread::yield();
+					}
+					work(t);
+				});
+			}
+			while(ready.load() < n) {
+				std::this_thread::yield();
+			}
+			auto t0 = std::chrono::steady_clock::now();
+			go.store(true, std::memory_order_release);
+			for(auto& thread: threads) {
+				thread.join();
+			}
+			return std::chrono::duration<double,std::nano>(
+				std::chrono::steady_clock::now() - t0
+				).count();
+		}
+
+	//	Best() runs a case once to warm up and then reps more times,
+	//	returning the fastest.
+	template<typename Run>
+		auto Best(const Options& opts, Run&& run) -> double {
+			run();
+			auto best = run();
+			for(int i = 1; i < opts.reps; ++i) {
+				best = std::min(best, run());
+			}
+			return best;
+		}
+
+	void Report(
+		const char* name, const char* type, const char* pol, const char* ref,
+		unsigned threads, double value, const char* unit
+		)
+	{
+		std::printf(
+			"%-7s %-7s %-11s %-7s %3u %10.1f %s\n",
+			name, type, pol, ref, threads, value, unit
+			);
+		std::fflush(stdout);
+	}
+
+	auto Selected(
+		const Options& opts, const char* name, const char* type,
+		const char* pol, const char* ref
+		) -> bool
+	{
+		auto full = std::string{name} + '/' + type + '/' + pol + '/' + ref;
+		return full.find(opts.filter) != std::string::npos;
+	}
+
+	//---- Cases ---------------------------------------------------------------
+
+	template<typename T, typename P, typename R>
+		auto HitCase(const Options& opts, unsigned n) -> double {
+			using Result = decltype(R::template Make<T,P>(std::declval<T>()));
+			std::vector<Result> hold;
+			for(std::size_t i = 0; i < kHot; ++i) {
+				hold.push_back(R::template Make<T,P>(Type<T>::Key(i)));
+			}
+			std::vector<std::vector<T>> keys(n);
+			auto ns = Best(opts, [&] {
+				return RunThreads(
+					n,
+					[&](unsigned t) {
+						if(keys[t].empty()) {
+							for(std::size_t i = 0; i < kOps; ++i) {
+								keys[t].push_back(Type<T>::Key(
+									SplitMix(t * kOps + i) % kHot
+									));
+							}
+						}
+					},
+					[&](unsigned t) {
+						for(auto& key: keys[t]) {
+							R::template Make<T,P>(key);
+						}
+						intern::Collect<T,typename Type<T>::Tuple,P>();
+					});
+			});
+			return ns / kOps;
+		}
+
+	template<typename T, typename P, typename R>
+		auto MissCase(const Options& opts, unsigned n) -> double {
+			std::vector<std::vector<T>> keys(n);
+			auto ns = Best(opts, [&] {
+				return RunThreads(
+					n,
+					[&](unsigned t) {
+						if(keys[t].empty()) {
+							for(std::size_t i = 0; i < kOps; ++i) {
+								keys[t].push_back(Type<T>::Key(
+									kHot + t * kOps + i
+									));
+							}
+						}
+					},
+					[&](unsigned t) {
+						for(auto& key: keys[t]) {
+							R::template Make<T,P>(key);
+						}
+						intern::Collect<T,typename Type<T>::Tuple,P>();
+					});
+			});
+			return ns / kOps;
+		}
+
+	template<typename T, typename P, typename R>
+		auto StormCase(const Options& opts, unsigned n) -> double {
+			using Result = decltype(R::template Make<T,P>(std::declval<T>()));
+			std::vector<std::vector<T>> keys(n);
+			std::vector<std::vector<Result>> held(n);
+			auto ns = Best(opts, [&] {
+				return RunThreads(
+					n,
+					[&](unsigned t) {
+						if(keys[t].empty()) {
+							for(std::size_t i = 0; i < kOps; ++i) {
+								keys[t].push_back(Type<T>::Key(
+									kHot + t * kOps + i
+									));
+							}
+						}
+						for(auto& key: keys[t]) {
+							held[t].push_back(R::template Make<T,P>(key));
+						}
+					},
+					[&](unsigned t) {
+						held[t].clear();
+						intern::Collect<T,typename Type<T>::Tuple,P>();
+					});
+			});
+			return ns / kOps;
+		}
+
+	template<typename T, typename P, typename R>
+		auto MemoryCase() -> double {
+			using Result = decltype(R::template Make<T,P>(std::declval<T>()));
+			std::vector<T> keys;
+			for(std::size_t i = 0; i < kOps; ++i) {
+				keys.push_back(Type<T>::Key(kHot + i));
+			}
+			std::vector<Result> held;
+			held.reserve(kOps);
+			auto before = gAllocated.load();
+			for(auto& key: keys) {
+				held.push_back(R::template Make<T,P>(key));
+			}
+			auto bytes = gAllocated.load() - before;
+			held.clear();
+			intern::Collect<T,typename Type<T>::Tuple,P>();
+			return static_cast<double>(bytes) / kOps;
+		}
+
+	template<typename T, typename P, typename R>
+		void RunAll(const Options& opts) {
+			auto type = Type<T>::kName;
+			auto pol = Policy<P>::kName;
+			auto ref = R::kName;
+
+			//	(This goes first, while the table is still empty, since the
+			//	other cases leave it with buckets and slots to spare.)
+			if(Selected(opts, "memory", type, pol, ref)) {
+				Report("memory", type, pol, ref, 1,
+					MemoryCase<T,P,R>(), "bytes/object");
+			}
+			for(unsigned n = 1; n <= opts.maxThreads; n *= 2) {
+				if(Selected(opts, "hit", type, pol, ref)) {
+					Report("hit", type, pol, ref, n,
+						HitCase<T,P,R>(opts, n), "ns/op");
+				}
+				if(Selected(opts, "miss", type, pol, ref)) {
+					Report("miss", type, pol, ref, n,
+						MissCase<T,P,R>(opts, n), "ns/op");
+				}
+				if(Selected(opts, "storm", type, pol, ref)) {
+					Report("storm", type, pol, ref, n,
+						StormCase<T,P,R>(opts, n), "ns/op");
+				}
+			}
+		}
+
+	template<typename T, typename... Ps>
+		void RunType(const Options& opts) {
+			(RunAll<T,Ps,Ref<false>>(opts), ...);
+			(RunAll<T,Ps,Ref<true>>(opts), ...);
+		}
+
+	template<typename T>
+		void RunPolicies(const Options& opts) {
+			RunType<
+				T,
+				policy::Default,
+				policy::Sharded<16>,
+				policy::LockFreeReads<policy::Sharded<16>>,
+				policy::FlatTable<policy::Sharded<16>>,
+				policy::PooledNodes<policy::Sharded<16>>,
+				policy::DeferredErase<1024,policy::Sharded<16>>,
+				policy::ThreadCache<64,policy::Sharded<16>>
+				>(opts);
+		}
+}
+
+int main(int argc, char* argv[]) {
+	Options opts;
+	opts.maxThreads = std::max(1u, std::thread::hardware_concurrency());
+	for(int i = 1; i < argc; ++i) {
+		if(std::strcmp(argv[i], "-t") == 0 && i + 1 < argc) {
+			opts.maxThreads = static_cast<unsigned>(
+				std::max(1, std::atoi(argv[++i]))
+				);
+		}
+		else if(std::strcmp(argv[i], "-r") == 0 && i + 1 < argc) {
+			opts.reps = std::max(1, std::atoi(argv[++i]));
+		}
+		else {
+			opts.filter = argv[i];
+		}
+	}
+	std::printf(
+		"%-7s %-7s %-11s %-7s %3s %10s\n",
+		"case", "type", "policy", "ref", "thr", "result"
+		);
+	RunPolicies<std::string>(opts);
+	RunPolicies<Color>(opts);
+	RunPolicies<Big>(opts);
+}
@@ -1,182 +1,5299 @@
 #ifndef INTERN_DEBUG
 	#define INTERN_DEBUG 0
 #endif
-#if INTERN_DEBUG
-	#include <iostream>
-	#include <stdexcept>
+
+#ifndef INTERN_SSE2
+	#if defined(__SSE2__) || defined(_M_X64) || \
+		(defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+		#define INTERN_SSE2 1
+	#else
+		#define INTERN_SSE2 0
+	#endif
+#endif
+#if INTERN_SSE2
+	#include <emmintrin.h>
+#endif
+
+#ifndef INTERN_MMAP
+	#if __has_include(<sys/mman.h>) && __has_include(<unistd.h>)
+		#define INTERN_MMAP 1
+	#else
+		#define INTERN_MMAP 0
+	#endif
+#endif
+#if INTERN_MMAP
+	#include <fcntl.h>
+	#include <sys/mman.h>
+	#include <sys/stat.h>
+	#include <unistd.h>
+#else
+	#include <fstream>
 #endif
 
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
 #include <climits>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <exception>
 #include <functional>
+#include <iterator>
+#include <limits>
 #include <memory>
+#include <memory_resource>
 #include <mutex>
+#include <new>
+#include <optional>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <thread>
 #include <tuple>
+#include <type_traits>
+#include <typeinfo>
 #include <unordered_map>
 #include <utility>
+#include <vector>
 
 namespace intern {
 
 	//---- Hash Utilities ------------------------------------------------------
 	//
-	//	Hash(args...) -> std::size_t:
+	//	A Hasher is a type with a static HashBytes(data, size) -> std::size_t
+	//	function that hashes a contiguous run of bytes. The functions below
+	//	take one as an optional leading template arg, and the interning tables
+	//	use whichever one their policy names (see policy::HashWith).
+	//
+	//	WyHasher:
+	//		The default Hasher. It follows the wyhash algorithm, which mixes
+	//		16 bytes at a time through 64 x 64 -> 128-bit multiplies. This is
+	//		fast on short keys and avalanches well, so that even an identity
+	//		std::hash (as libstdc++ uses for integers) comes out scrambled.
+	//
+	//	HashBytes<Hasher=WyHasher>(data, size) -> std::size_t:
+	//		Hashes size bytes starting at data.
+	//
+	//	Hash<Hasher=WyHasher>(args...) -> std::size_t:
 	//		This function hashes one or more args. std::hash is used to
-	//		calculate a hash value on each arg. If there are multiple args,
-	//		the hash values are combined into one.
+	//		calculate a hash value on each arg. These are laid out in an array
+	//		and hashed in one go with HashBytes(), so none of them waits on
+	//		another. (This holds for a single arg too, so that an identity
+	//		std::hash still comes out scrambled.)
 	//
-	//	HashTuple(arg) -> std::size_t:
+	//	HashTuple<Hasher=WyHasher>(arg) -> std::size_t:
 	//		This function calls Hash() on the elements of a tuple-like arg
-	//		(e.g. std::tuple, std::pair, std::array).
+	//		(e.g. std::tuple, std::pair, std::array). If the elements are all
+	//		integers, enums, or pointers, and the tuple has no padding, it
+	//		skips std::hash and runs HashBytes() over the whole tuple instead.
+	//		A std::array of float or double gets the same treatment, once any
+	//		negative zeros are turned positive (since -0.0 == 0.0).
+	//
+	//		Elements that are themselves interned references (the shared
+	//		pointers MakeInterned() returns, Handles, and Ids) are hashed by
+	//		identity: a shared pointer by address, a Handle by the hash stored
+	//		with its object, and an Id by its value. This makes hash-consing
+	//		cheap. A composite whose tuple holds references to its interned
+	//		parts costs O(fields) to hash and compare, however deep the parts
+	//		go, since == on such references compares addresses too.
 
-	template<typename T, typename... Ts>
-		constexpr auto Hash(const T& v, const Ts&... vs) -> std::size_t {
-			if constexpr(sizeof...(Ts) == 0) {
-				return std::hash<T>{}(v);
+	struct WyHasher {
+		static auto HashBytes(const void* data, std::size_t size)
+			-> std::size_t
+		{
+			auto p = static_cast<const unsigned char*>(data);
+			std::uint64_t seed = kP0 ^ Mix(kP0, kP1), a, b;
+			if(size <= 16) {
+				if(size >= 4) {
+					auto mid = (size >> 3) << 2;
+					a = Read4(p) << 32 | Read4(p + mid);
+					b = Read4(p + size - 4) << 32 | Read4(p + size - 4 - mid);
+				}
+				else if(size > 0) {
+					a = std::uint64_t{p[0]} << 16 |
+						std::uint64_t{p[size >> 1]} << 8 | p[size - 1];
+					b = 0;
+				}
+				else {
+					a = b = 0;
+				}
 			}
 			else {
-				//	The algorithm for combining hashes was "boosted" from
-				//	boost's hash_combine() function. The only change was to
-				//	extend the "magic" number to 64 bits where appropriate.
-				//	(Also, the hashes are combined in the reverse order of the
-				//	args for recursion's sake, not that it matters.)
-				constexpr std::size_t kMagic =
-					sizeof(std::size_t) * CHAR_BIT > 32u ?
-					0x9e3779b97f4a7c15 : 0x9e3779b9;
-				auto seed = Hash(vs...);
-				return seed ^ (Hash(v) + kMagic + (seed << 6) + (seed >> 2));
-			}
-		}
-	template<typename Tuple>
-		constexpr auto HashTuple(const Tuple& tuple) {
+				auto i = size;
+				if(i > 48) {
+					auto seed1 = seed, seed2 = seed;
+					do {
+						seed = Mix(Read8(p) ^ kP1, Read8(p + 8) ^ seed);
+						seed1 = Mix(Read8(p + 16) ^ kP2, Read8(p + 24) ^ seed1);
+						seed2 = Mix(Read8(p + 32) ^ kP3, Read8(p + 40) ^ seed2);
+						p += 48;
+						i -= 48;
+					} while(i > 48);
+					seed ^= seed1 ^ seed2;
+				}
+				for(; i > 16; i -= 16, p += 16) {
+					seed = Mix(Read8(p) ^ kP1, Read8(p + 8) ^ seed);
+				}
+				a = Read8(p + i - 16);
+				b = Read8(p + i - 8);
+			}
+			Multiply(a ^= kP1, b ^= seed);
+			auto h = Mix(a ^ kP0 ^ size, b ^ kP1);
+			if constexpr(sizeof(std::size_t) < sizeof h) {
+				h ^= h >> 32;
+			}
+			return static_cast<std::size_t>(h);
+		}
+
+	private:
+		static constexpr std::uint64_t kP0 = 0xa0761d6478bd642f;
+		static constexpr std::uint64_t kP1 = 0xe7037ed1a0b428db;
+		static constexpr std::uint64_t kP2 = 0x8ebc6af09c88c6e3;
+		static constexpr std::uint64_t kP3 = 0x589965cc75374cc3;
+	 #if defined(__SIZEOF_INT128__)
+
+		//	__extension__ keeps -Wpedantic quiet about the non-standard type.
+		__extension__ typedef unsigned __int128 UInt128;
+	 #endif
+
+		//	Replaces a and b with the low and high halves of a * b.
+		static void Multiply(std::uint64_t& a, std::uint64_t& b) {
+		 #if defined(__SIZEOF_INT128__)
+			auto r = static_cast<UInt128>(a) * b;
+			a = static_cast<std::uint64_t>(r);
+			b = static_cast<std::uint64_t>(r >> 64);
+		 #else
+			std::uint64_t ha = a >> 32, hb = b >> 32;
+			std::uint64_t la = a & 0xffffffff, lb = b & 0xffffffff;
+			std::uint64_t hi = ha * hb, m0 = ha * lb, m1 = hb * la, lo = la * lb;
+			std::uint64_t t = lo + (m0 << 32), c = t < lo;
+			lo = t + (m1 << 32);
+			c += lo < t;
+			a = lo;
+			b = hi + (m0 >> 32) + (m1 >> 32) + c;
+		 #endif
+		}
+		static auto Mix(std::uint64_t a, std::uint64_t b) -> std::uint64_t {
+			Multiply(a, b);
+			return a ^ b;
+		}
+		static auto Read8(const unsigned char* p) -> std::uint64_t {
+			std::uint64_t v;
+			std::memcpy(&v, p, sizeof v);
+			return v;
+		}
+		static auto Read4(const unsigned char* p) -> std::uint64_t {
+			std::uint32_t v;
+			std::memcpy(&v, p, sizeof v);
+			return v;
+		}
+	};
+
+	template<typename Hasher=WyHasher>
+		auto HashBytes(const void* data, std::size_t size) -> std::size_t {
+			return Hasher::HashBytes(data, size);
+		}
+	template<typename Hasher=WyHasher, typename T, typename... Ts>
+		auto Hash(const T& v, const Ts&... vs) -> std::size_t {
+			const std::size_t hashes[] = {
+				std::hash<T>{}(v), std::hash<Ts>{}(vs)...
+				};
+			return Hasher::HashBytes(hashes, sizeof hashes);
+		}
+
+	namespace details {
+
+		//	IsBytewise<Tuple>::value is true if Tuple is a tuple-like type made
+		//	up of integers, enums, and/or pointers with no padding in between.
+		//	Two such tuples are equal exactly when their bytes are. This is
+		//	decided element by element, since the standard library does not
+		//	report std::tuple or std::pair as having unique representations
+		//	even when they do: with every element free of padding bits and
+		//	the sizes adding up, there are no other bytes to compare.
+		template<typename Tuple, typename Seq=void>
+			struct IsBytewise: std::false_type {};
+		template<typename Tuple, std::size_t... Is>
+			struct IsBytewise<Tuple, std::index_sequence<Is...>>:
+				std::bool_constant<
+					std::is_trivially_copy_constructible_v<Tuple> &&
+					std::is_trivially_destructible_v<Tuple> &&
+					sizeof(Tuple) ==
+						(sizeof(std::tuple_element_t<Is,Tuple>) + ...) &&
+					((	std::is_scalar_v<std::tuple_element_t<Is,Tuple>> &&
+						std::has_unique_object_representations_v<
+							std::tuple_element_t<Is,Tuple>
+							>) && ...)
+					> {};
+		template<typename Tuple>
+			constexpr bool kIsBytewise = IsBytewise<
+				Tuple, std::make_index_sequence<std::tuple_size_v<Tuple>>
+				>::value;
+
+		//	FloatBits<Tuple>::Type is the unsigned integer type the same size
+		//	as E if Tuple is a std::array<E,N> with E an IEEE float or double,
+		//	and void otherwise.
+		template<typename Tuple>
+			struct FloatBits {
+				using Type = void;
+			};
+		template<typename E, std::size_t N>
+			struct FloatBits<std::array<E,N>> {
+				static constexpr bool kIEEE =
+					std::is_floating_point_v<E> &&
+					std::numeric_limits<E>::is_iec559 &&
+					(sizeof(E) == 4 || sizeof(E) == 8);
+				using Type = std::conditional_t<
+					!kIEEE, void,
+					std::conditional_t<
+						sizeof(E) == 4, std::uint32_t, std::uint64_t
+						>
+					>;
+			};
+	}
+
+	template<typename Hasher=WyHasher, typename Tuple>
+		auto HashTuple(const Tuple& tuple) -> std::size_t {
 			static_assert(
 				std::tuple_size_v<Tuple>, "empty tuples cannot be hashed"
 				);
-			return std::apply(
-				[](const auto&... args) { return Hash(args...); }, tuple
+			using Bits = typename details::FloatBits<Tuple>::Type;
+			if constexpr(details::kIsBytewise<Tuple>) {
+				return Hasher::HashBytes(std::addressof(tuple), sizeof tuple);
+			}
+			else if constexpr(!std::is_void_v<Bits>) {
+				constexpr auto kN = std::tuple_size_v<Tuple>;
+				Bits bits[kN];
+				for(std::size_t i = 0; i < kN; ++i) {
+					auto v = tuple[i] == 0 ? 0 : tuple[i];
+					std::memcpy(&bits[i], &v, sizeof v);
+				}
+				return Hasher::HashBytes(bits, sizeof bits);
+			}
+			else {
+				return std::apply(
+					[](const auto&... args) { return Hash<Hasher>(args...); },
+					tuple
+					);
+			}
+		}
+
+	//---- Tracing -------------------------------------------------------------
+	//
+	//	Event:
+	//		The things a table does to its entries: kIntern inserts a new one,
+	//		kFetch finds an existing one, and kErase removes one.
+	//
+	//	TraceRecord:
+	//		Describes one Event: the type of object involved and its hash.
+	//
+	//	A Tracer is a type with a static Trace(const TraceRecord&) noexcept
+	//	function. A table whose policy names one (see policy::TraceWith) calls
+	//	it for every event, usually while holding a shard's mutex, so it had
+	//	better be quick and must not intern anything itself. Without a Tracer,
+	//	there are no calls to make and tracing costs nothing.
+	//
+	//	TraceRing<N=4096>:
+	//		A Tracer that keeps the last N records (N must be a power of 2) in
+	//		a fixed ring shared by every table that uses it. Recording one is
+	//		wait-free: an atomic increment picks a slot, which is then filled
+	//		in under a sequence number so that readers can tell a torn record
+	//		from a whole one. Drain() returns the records made since the last
+	//		Drain(), oldest first, minus any that have since been overwritten
+	//		or are still being written. It is meant to be called from one
+	//		thread at a time.
+	//
+	//	Defining INTERN_DEBUG as 1 makes TraceRing<> the default Tracer.
+
+	enum class Event { kIntern, kFetch, kErase };
+
+	struct TraceRecord {
+		Event event;
+		const std::type_info* type;
+		std::size_t hash;
+	};
+
+	template<std::size_t N=4096>
+		class TraceRing {
+		public:
+			static_assert(
+				N > 0 && (N & (N - 1)) == 0,
+				"trace ring size must be a power of 2"
 				);
+
+			static void Trace(const TraceRecord& record) noexcept {
+				auto ticket = gNext.fetch_add(1u, std::memory_order_relaxed);
+				auto& slot = gSlots[ticket & (N - 1)];
+				slot.seq.store(2u * ticket + 1u, std::memory_order_relaxed);
+
+				//	(Releasing each field ensures that a reader who sees any of
+				//	them also sees the odd sequence number stored before.)
+				slot.event.store(record.event, std::memory_order_release);
+				slot.type.store(record.type, std::memory_order_release);
+				slot.hash.store(record.hash, std::memory_order_release);
+				slot.seq.store(2u * ticket + 2u, std::memory_order_release);
+			}
+			static auto Drain() -> std::vector<TraceRecord> {
+				auto end = gNext.load(std::memory_order_acquire);
+				auto begin = gRead.exchange(end, std::memory_order_relaxed);
+				std::vector<TraceRecord> records;
+				if(begin >= end) {
+					return records;
+				}
+				if(end - begin > N) {
+					begin = end - N;
+				}
+				records.reserve(end - begin);
+				for(auto ticket = begin; ticket < end; ++ticket) {
+					auto& slot = gSlots[ticket & (N - 1)];
+					auto seq = slot.seq.load(std::memory_order_acquire);
+					if(seq != 2u * ticket + 2u) {
+						continue;
+					}
+					TraceRecord record{
+						slot.event.load(std::memory_order_acquire),
+						slot.type.load(std::memory_order_acquire),
+						slot.hash.load(std::memory_order_acquire)
+						};
+					if(slot.seq.load(std::memory_order_relaxed) == seq) {
+						records.push_back(record);
+					}
+				}
+				return records;
+			}
+
+		private:
+			struct Slot {
+				std::atomic<std::uint64_t> seq{0};
+				std::atomic<Event> event{Event::kIntern};
+				std::atomic<const std::type_info*> type{nullptr};
+				std::atomic<std::size_t> hash{0};
+			};
+
+			static inline std::array<Slot,N> gSlots{};
+			static inline std::atomic<std::uint64_t> gNext{0};
+			static inline std::atomic<std::uint64_t> gRead{0};
+		};
+
+	//---- Policies ------------------------------------------------------------
+	//
+	//	A policy is a struct of static constants (and the odd type alias) that
+	//	tunes how the interning table for a particular T is laid out. You pass
+	//	it as the 3rd template arg of MakeInterned(). Policies compose by
+	//	inheritance, so you can derive from policy::Default (or any other
+	//	policy) and override only the constants you care about.
+	//
+	//	policy::Default:
+	//		One table guarded by one mutex. This is what you get if you do not
+	//		specify a policy.
+	//
+	//	policy::Sharded<N,Base=policy::Default>:
+	//		Splits the table into N shards (N must be a power of 2), each with
+	//		its own mutex and map. Objects are assigned to shards by their hash
+	//		values, so threads interning different objects will mostly lock
+	//		different mutexes.
+	//
+	//	policy::TupleArgs<Base=policy::Default>:
+	//		Promises that the args you pass to MakeInterned() are exactly the
+	//		elements of your Tuple, such that T{args...} cast to Tuple compares
+	//		equal to Tuple{args...}. MakeInterned() can then look the object
+	//		up in tuple form and only construct a T on a miss. (This is true of
+	//		the Color example in the README, but would not be true of a class
+	//		whose constructor normalizes its inputs.)
+	//
+	//	policy::LockFreeReads<Base=policy::Default>:
+	//		Look-ups that find an existing object do so without locking any
+	//		mutex. Only insertions and erasures serialize on the shard's mutex.
+	//		Readers do still increment and decrement an atomic counter per
+	//		shard, so this combines well with policy::Sharded.
+	//
+	//	policy::FlatTable<Base=policy::Default>:
+	//		Replaces the node-based std::unordered_multimap in each shard with
+	//		a flat, open-addressing table in the style of Google's Swiss
+	//		tables. A look-up scans 16 one-byte hash fragments at a time (with
+	//		SSE2 where available) and only dereferences entries whose fragment
+	//		matches. The entries themselves are carved out of slabs so that
+	//		they keep stable addresses.
+	//
+	//	The last two are mutually exclusive, since each picks a different
+	//	Backend for the shards.
+	//
+	//	policy::WithAllocator<Alloc,Base=policy::Default>:
+	//		Has the shards allocate their entries (and, with the default
+	//		Backend, their map nodes) through Alloc, rebound as needed. Alloc
+	//		is default-constructed for each shard, so a
+	//		std::pmr::polymorphic_allocator would pick up whatever
+	//		std::pmr::get_default_resource() returns at that point.
+	//
+	//	policy::PooledNodes<Base=policy::Default>:
+	//		Gives each shard its own std::pmr::unsynchronized_pool_resource to
+	//		allocate entries from, in place of Allocator. Since objects of a
+	//		given T tend to be the same size, these land in a single
+	//		size-classed pool and get recycled rather than going back and forth
+	//		to malloc. (No extra locking is needed since shards only ever
+	//		allocate and free while holding their mutex.)
+	//
+	//	policy::DeferredErase<N=1024,Base=policy::Default>:
+	//		Normally, an entry is erased (locking its shard) the moment its last
+	//		reference goes away. With this policy, the entry is instead added
+	//		to a thread-local retire list, and once N entries have piled up,
+	//		they are erased in batches, locking each shard once. You can also
+	//		flush the calling thread's list early with Collect() (see below),
+	//		e.g. at the end of a frame. A look-up that finds a dead entry
+	//		still awaiting erasure revives it, as with Retain below, rather
+	//		than allocating a replacement, and the pending erasure then
+	//		leaves it be. The exception is MakeInterned() with
+	//		LockFreeReads, where reviving would mean storing a new weak
+	//		pointer under lock-free readers, so a dead entry is skipped and
+	//		a replacement inserted alongside it.
+	//
+	//	policy::Retain<N=256,Base=policy::Default>:
+	//		Keeps up to N recently released objects per shard alive after their
+	//		last reference goes away, so that re-interning one soon afterwards
+	//		revives it rather than constructing a new one. Released objects
+	//		enter a first-in, first-out ring, and are only erased once N more
+	//		have been released after them (and nobody has picked them up again
+	//		in the meantime). Reviving an object returned by MakeInterned()
+	//		still costs a fresh shared_ptr control block, but no new entry.
+	//		This policy cannot be combined with LockFreeReads for
+	//		MakeInterned(), but can for MakeHandle().
+	//
+	//	policy::HashWith<Hasher,Base=policy::Default>:
+	//		Has the table hash Tuple values with HashTuple<Hasher>() rather
+	//		than HashTuple<WyHasher>(). (Without a Tuple, T values are hashed
+	//		with std::hash<T>, and this policy has no effect.)
+	//
+	//	policy::ThreadCache<N=64,Base=policy::Default>:
+	//		Puts a small direct-mapped cache of N slots (N must be a power of
+	//		2) in front of the table in each thread. A slot holds the last
+	//		reference the thread got for any object whose hash maps to it, so
+	//		a thread that keeps asking for the same few objects finds them
+	//		without taking a lock or even looking at the shared table. Since
+	//		the references are strong, cached objects stay alive until they
+	//		are displaced from the cache, the thread calls Collect() (see
+	//		below), or the thread exits.
+	//
+	//	policy::SingleThread<Base=policy::Default>:
+	//		Drops all synchronization from the table: the shards' mutexes become
+	//		no-ops, and the reference counts of the Handles returned by
+	//		MakeHandle() (and the slots behind MakeId()'s Ids) are plain
+	//		integers rather than atomics. Use this when every object of a given
+	//		T/Tuple/Policy is interned, copied, and released by one thread at a
+	//		time, e.g. in an offline tool or a pipeline stage that owns its
+	//		data outright. (The shared pointers returned by MakeInterned() are
+	//		still counted atomically, since that is up to std::shared_ptr, so
+	//		prefer MakeHandle() here.) This policy cannot be combined with
+	//		LockFreeReads, which exists only to make concurrent readers cheap.
+	//
+	//	policy::MultiThread<Base=policy::Default>:
+	//		The default: tables are safe to use from any number of threads.
+	//		You would only need this to undo SingleThread in a base policy.
+	//
+	//	policy::WithStats<Base=policy::Default>:
+	//		Has the table count what it does for Stats() (see below): how many
+	//		objects were interned, fetched, and erased, and how often and how
+	//		long threads waited to lock a shard. The counts are kept per thread
+	//		and per table, so counting costs a few unshared increments rather
+	//		than any extra synchronization.
+	//
+	//	policy::MaxLoad<Percent,Base=policy::Default>:
+	//		Sets how full (as a percentage from 10 to 95) each shard may get
+	//		before it grows. By default, this is 100% for the default Backend,
+	//		50% for LockFreeReads (counting tombstones), and 87.5% for
+	//		FlatTable (likewise). Lower loads trade memory for shorter probes.
+	//
+	//	policy::IncrementalRehash<N=64,Base=policy::Default>:
+	//		Normally, a shard that outgrows its slots moves every entry into a
+	//		bigger array then and there, while holding its mutex, which stalls
+	//		everyone waiting on it for as long as that takes. With this policy,
+	//		it keeps the old array around instead, and each insertion moves the
+	//		next N of its slots over until it is empty. Look-ups meanwhile check
+	//		both arrays. This policy requires FlatTable.
+	//
+	//	policy::TraceWith<Tracer,Base=policy::Default>:
+	//		Reports every interning, fetch, and erasure to Tracer (see the
+	//		Tracing section above), e.g. TraceRing<>. Pass void to turn
+	//		tracing off again.
+	//
+	//	policy::Compact<Base=policy::Default>:
+	//		Drops the 8-byte hash value each entry normally keeps, recomputing
+	//		it from the object on the rare occasions the table needs it again:
+	//		to erase the entry, and to move it when its shard grows. Together
+	//		with MakeHandle(), FlatTable, and PooledNodes, this leaves an
+	//		entry holding just the object and two 32-bit counts (references
+	//		and revivals), which for a 12-byte Color is 20 bytes, plus 10 to
+	//		18 bytes of slots depending on how full the shard is. (The README
+	//		has measurements.) In exchange, rehashing and erasing cost a hash
+	//		of each object, LockFreeReads look-ups can no longer skip
+	//		mismatched neighbours by hash, and Handle::hash() hashes the
+	//		object rather than reading a stored value. The hash you pass to
+	//		Intern() and friends must also then be exact. Compact combines
+	//		with every other policy, IncrementalRehash included.
+
+	namespace policy {
+		enum class Backend { kMap, kLockFree, kFlat };
+
+		struct Default {
+			static constexpr std::size_t kShards = 1;
+			static constexpr bool kTupleArgs = false;
+			static constexpr Backend kBackend = Backend::kMap;
+			static constexpr bool kPooled = false;
+			using Allocator = std::allocator<std::byte>;
+			static constexpr std::size_t kEraseBatch = 0;
+			static constexpr std::size_t kRetain = 0;
+			using Hasher = WyHasher;
+			static constexpr std::size_t kThreadCache = 0;
+			static constexpr bool kThreadSafe = true;
+			static constexpr bool kStats = false;
+			static constexpr unsigned kMaxLoad = 0;  // i.e. the Backend's own
+			static constexpr std::size_t kRehashStep = 0;  // i.e. all at once
+			static constexpr bool kCompact = false;
+			using Tracer = std::conditional_t<
+				INTERN_DEBUG != 0, TraceRing<>, void
+				>;
+		};
+		template<std::size_t N, typename Base=Default>
+			struct Sharded: Base {
+				static_assert(
+					N > 0 && (N & (N - 1)) == 0,
+					"shard count must be a power of 2"
+					);
+				static constexpr std::size_t kShards = N;
+			};
+		template<typename Base=Default>
+			struct TupleArgs: Base {
+				static constexpr bool kTupleArgs = true;
+			};
+		template<typename Base=Default>
+			struct LockFreeReads: Base {
+				static constexpr Backend kBackend = Backend::kLockFree;
+			};
+		template<typename Base=Default>
+			struct FlatTable: Base {
+				static constexpr Backend kBackend = Backend::kFlat;
+			};
+		template<typename Alloc, typename Base=Default>
+			struct WithAllocator: Base {
+				using Allocator = Alloc;
+			};
+		template<typename Base=Default>
+			struct PooledNodes: Base {
+				static constexpr bool kPooled = true;
+			};
+		template<std::size_t N=1024, typename Base=Default>
+			struct DeferredErase: Base {
+				static_assert(N > 0, "erase batch size must be positive");
+				static constexpr std::size_t kEraseBatch = N;
+			};
+		template<std::size_t N=256, typename Base=Default>
+			struct Retain: Base {
+				static constexpr std::size_t kRetain = N;
+			};
+		template<typename H, typename Base=Default>
+			struct HashWith: Base {
+				using Hasher = H;
+			};
+		template<std::size_t N=64, typename Base=Default>
+			struct ThreadCache: Base {
+				static_assert(
+					N > 0 && (N & (N - 1)) == 0,
+					"thread cache size must be a power of 2"
+					);
+				static constexpr std::size_t kThreadCache = N;
+			};
+		template<typename Base=Default>
+			struct SingleThread: Base {
+				static constexpr bool kThreadSafe = false;
+			};
+		template<typename Base=Default>
+			struct MultiThread: Base {
+				static constexpr bool kThreadSafe = true;
+			};
+		template<typename Base=Default>
+			struct WithStats: Base {
+				static constexpr bool kStats = true;
+			};
+		template<unsigned Percent, typename Base=Default>
+			struct MaxLoad: Base {
+				static_assert(
+					Percent >= 10 && Percent <= 95,
+					"max load must be from 10 to 95 percent"
+					);
+				static constexpr unsigned kMaxLoad = Percent;
+			};
+		template<std::size_t N=64, typename Base=Default>
+			struct IncrementalRehash: Base {
+				static_assert(N > 0, "rehash step must be positive");
+				static constexpr std::size_t kRehashStep = N;
+			};
+		template<typename Tr, typename Base=Default>
+			struct TraceWith: Base {
+				using Tracer = Tr;
+			};
+		template<typename Base=Default>
+			struct Compact: Base {
+				static constexpr bool kCompact = true;
+			};
+	}
+
+	//---- Statistics ----------------------------------------------------------
+	//
+	//	TableStats:
+	//		What Stats() (see below) returns. The event counts and lock waits
+	//		are only counted with policy::WithStats, and are totals since the
+	//		program started. The rest describe the table as it is now. bytes
+	//		estimates the memory held by the table itself (entries, buckets,
+	//		and slots), not counting allocator overhead or anything your
+	//		objects allocate on their own. shardSizes gives the number of live
+	//		entries in each shard, so you can see how evenly they are spread.
+
+	struct TableStats {
+		std::uint64_t interns = 0;
+		std::uint64_t fetches = 0;
+		std::uint64_t erases = 0;
+		std::uint64_t lockWaits = 0;
+		std::chrono::nanoseconds lockWaitTime{0};
+		std::size_t live = 0;
+		std::size_t capacity = 0;
+		std::size_t bytes = 0;
+		std::vector<std::size_t> shardSizes;
+
+		//	The fraction of interning requests that found an existing object.
+		auto HitRate() const noexcept -> double {
+			auto n = fetches + interns;
+			return n ? static_cast<double>(fetches) / n : 0.0;
 		}
+		auto LoadFactor() const noexcept -> double {
+			return capacity ? static_cast<double>(live) / capacity : 0.0;
+		}
+	};
+
+	template<typename T, typename Tuple=void, typename Policy=policy::Default>
+		class Handle;
+	template<typename T, typename Tuple=void, typename Policy=policy::Default>
+		class Id;
 
 	//--------------------------------------------------------------------------
 
 	namespace details {
 
-		//	The Map class specifies an appropriate unordered_map type depending
-		//	on whether Tuple is supplied. In either case, the T type serves
-		//	as the key and a weak pointer to const T serves as the value. The
-		//	idea is that the pointer points to the key, which is safe with
-		//	unordered_map because keys never get shuffled around in memory.
+		//	Construct() builds a T out of args. Like MakeInterned() always has,
+		//	it uses brace-initialization so that aggregates work, except when
+		//	handed a T already, in which case it copies or moves it.
+		template<typename T, typename... Args>
+			auto Construct(Args&&... args) -> T {
+				if constexpr(
+					sizeof...(Args) == 1 &&
+					(std::is_same_v<std::decay_t<Args>,T> && ...)
+					)
+				{
+					return T(std::forward<Args>(args)...);
+				}
+				else {
+					return T{std::forward<Args>(args)...};
+				}
+			}
+
+		template<typename Alloc, typename U>
+			using Rebind =
+				typename std::allocator_traits<Alloc>::template rebind_alloc<U>;
+
+		//	EntryHash is the base that stores an Entry's hash (see below), or
+		//	with policy::Compact, stores nothing.
+		template<bool kStored>
+			struct EntryHash {
+				std::size_t hash;
+
+				explicit EntryHash(std::size_t hash) noexcept: hash{hash} {}
+			};
+		template<>
+			struct EntryHash<false> {
+				explicit EntryHash(std::size_t) noexcept {}
+			};
+
+		//	Entry is the value type of the map. It holds the interned object
+		//	itself plus whatever the Ref type (see SharedRef and HandleRef
+		//	below) needs to hand out references to it. The idea is that these
+		//	refer to the value right next to them, which is safe with
+		//	unordered_multimap because its nodes never get shuffled around in
+		//	memory.
+		//
+		//	The object's hash value is computed once, on the miss that inserts
+		//	it, and kept in the Entry (see EntryHash). Erasing and rehashing
+		//	reuse it, as does Handle::hash(), all through Hash().
+		//
+		//	revivals counts how many times the entry has been brought back to
+		//	life by a look-up since its last reference went (see Claim()),
+		//	which is how many of the erasures still headed its way it should
+		//	survive. It is guarded by the shard's mutex, and is always 0 for
+		//	uncounted Refs.
+		template<typename T, typename Ref>
+			struct Entry: EntryHash<Ref::kHashed> {
+				T value;
+				typename Ref::Data ref{};
+				std::uint32_t revivals = 0;
+
+				template<typename... Args>
+					explicit Entry(std::size_t hash, Args&&... args):
+						EntryHash<Ref::kHashed>{hash},
+						value{Construct<T>(std::forward<Args>(args)...)} {}
+
+				auto Hash() const -> std::size_t {
+					if constexpr(Ref::kHashed) {
+						return this->hash;
+					}
+					else {
+						return typename Ref::ValueHash{}(value);
+					}
+				}
+			};
+
+		//	Node wraps an Entry for backends that track entries by pointer
+		//	rather than storing them in std containers. These allocate Nodes
+		//	individually.
+		template<typename T, typename Ref>
+			struct Node {
+				Entry<T,Ref> entry;
+
+				template<typename... Args>
+					Node(std::size_t hash, Args&&... args):
+						entry{hash, std::forward<Args>(args)...} {}
+			};
+
+		//	AsTuple<Tuple>(v) returns v as a const Tuple&, if T derives from
+		//	Tuple or has a conversion operator returning one. Otherwise, it
+		//	returns a Tuple by value from T's (possibly explicit) conversion
+		//	operator or Tuple's constructor.
+		template<typename Tuple, typename T, typename = void>
+			struct HasTupleRef: std::false_type {};
+		template<typename Tuple, typename T>
+			struct HasTupleRef<
+				Tuple, T,
+				std::void_t<decltype(
+					std::declval<const T&>().operator const Tuple&()
+					)>
+				>: std::true_type {};
+
+		template<typename Tuple, typename T>
+			auto AsTuple(const T& v) -> std::conditional_t<
+				std::is_base_of_v<Tuple,T> || HasTupleRef<Tuple,T>::value,
+				const Tuple&, Tuple
+				>
+			{
+				if constexpr(std::is_base_of_v<Tuple,T>) {
+					return v;
+				}
+				else if constexpr(HasTupleRef<Tuple,T>::value) {
+					return v.operator const Tuple&();
+				}
+				else {
+					return static_cast<Tuple>(v);
+				}
+			}
+
+		//	TupleEquals() compares bytewise tuples (see IsBytewise) with
+		//	memcmp, which compilers turn into a few wide loads and compares.
+		//	Other tuples are compared with ==.
+		template<typename Tuple>
+			auto TupleEquals(const Tuple& a, const Tuple& b) -> bool {
+				if constexpr(kIsBytewise<Tuple>) {
+					return std::memcmp(
+						std::addressof(a), std::addressof(b), sizeof(Tuple)
+						) == 0;
+				}
+				else {
+					return a == b;
+				}
+			}
+
+		//	The Map class specifies Hash and Equal functors for T, which depend
+		//	on whether Tuple is supplied. The map type itself (TMap) is keyed on
+		//	hash values rather than T, though. That way, an object can be looked
+		//	up by anything that hashes the same way (see Probe below) without
+		//	first constructing a T.
 		//
-		//	When a Tuple is supplied, the unordered_map gains additional
-		//	TupEqual and TupHash functors which static_cast the T values to
-		//	tuples to do their work.
-		template<typename T, typename Tuple>
+		//	When a Tuple is supplied, TupEqual and TupHash convert the T values
+		//	to tuples with AsTuple() to do their work.
+		template<typename T, typename Tuple, typename Policy>
 			struct Map {
 				struct TupEqual {
 					auto operator () (const T& a, const T& b) const {
-						auto& aTup = static_cast<const Tuple&>(a);
-						auto& bTup = static_cast<const Tuple&>(b);
-						return aTup == bTup;
+						return TupleEquals<Tuple>(
+							AsTuple<Tuple>(a), AsTuple<Tuple>(b)
+							);
 					}
 				};
 				struct TupHash {
 					auto operator () (const T& v) const {
-						return HashTuple(static_cast<const Tuple&>(v));
+						using Hasher = typename Policy::Hasher;
+						return HashTuple<Hasher>(AsTuple<Tuple>(v));
 					}
 				};
-				using Type = std::unordered_map<
-					T, std::weak_ptr<const T>, TupHash, TupEqual
-					>;
+				using Hash = TupHash;
+				using Equal = TupEqual;
+			};
+		template<typename T, typename Policy>
+			struct Map<T,void,Policy> {
+				using Hash = std::hash<T>;
+				using Equal = std::equal_to<T>;
+			};
+		template<typename T, typename Ref, typename Alloc>
+			using TMap = std::unordered_multimap<
+				std::size_t, Entry<T,Ref>,
+				std::hash<std::size_t>, std::equal_to<std::size_t>,
+				Rebind<Alloc, std::pair<const std::size_t, Entry<T,Ref>>>
+				>;
+
+		//	A Probe is what MakeInterned() looks up in the map. It pairs a View
+		//	of the object, which can be hashed and compared against stored T
+		//	values, with the original args, which are only used to construct a
+		//	T on a miss. View may be:
+		//
+		//		const T&: the caller handed us a T already
+		//		std::basic_string_view: T is a std::basic_string and the caller
+		//			handed us something convertible to a string view (the
+		//			standard guarantees both hash the same)
+		//		Tuple: the policy says the args are tuple elements
+		//		T: none of the above, so the args are used to construct a
+		//			temporary T up front (and args are left empty)
+		template<
+			typename T, typename Tuple, typename Policy, typename View,
+			typename... Args
+			>
+			struct Probe {
+				using TView = std::remove_cv_t<std::remove_reference_t<View>>;
+
+				View view;
+				std::tuple<Args&&...> args;
+
+				auto Hash() const -> std::size_t {
+					if constexpr(std::is_same_v<TView,T>) {
+						return typename Map<T,Tuple,Policy>::Hash{}(view);
+					}
+					else if constexpr(std::is_same_v<TView,Tuple>) {
+						return HashTuple<typename Policy::Hasher>(view);
+					}
+					else {
+						return std::hash<TView>{}(view);
+					}
+				}
+				auto Matches(const T& v) const -> bool {
+					if constexpr(std::is_same_v<TView,T>) {
+						return typename Map<T,Tuple,Policy>::Equal{}(v, view);
+					}
+					else if constexpr(std::is_same_v<TView,Tuple>) {
+						return TupleEquals<Tuple>(AsTuple<Tuple>(v), view);
+					}
+					else {
+						return v == view;
+					}
+				}
+
+				//	Returns a tuple of args from which to construct the Entry.
+				auto EntryArgs() {
+					if constexpr(std::is_same_v<View,T>) {
+						return std::forward_as_tuple(std::move(view));
+					}
+					else {
+						return std::move(args);
+					}
+				}
 			};
+
+		//	StringView<T>::Type is the std::basic_string_view corresponding to
+		//	T if T is a std::basic_string, and void otherwise.
 		template<typename T>
-			struct Map<T,void> {
-				using Type = std::unordered_map<T, std::weak_ptr<const T>>;
+			struct StringView {
+				using Type = void;
+			};
+		template<typename C, typename A>
+			struct StringView<std::basic_string<C,std::char_traits<C>,A>> {
+				using Type = std::basic_string_view<C>;
 			};
-		template<typename T, typename Tuple>
-			using TMap = typename Map<T,Tuple>::Type;
 
-		using TMutex = std::mutex;
+		template<typename Tuple, typename = void, typename... Args>
+			struct IsBraceConstructible: std::false_type {};
+		template<typename Tuple, typename... Args>
+			struct IsBraceConstructible<
+				Tuple, std::void_t<decltype(Tuple{std::declval<Args>()...})>,
+				Args...
+				>: std::true_type {};
 
-		//	Unlike a traditional shared_ptr, those returned by MakeInterned() do
-		//	not allocate memory directly. Rather, they let global unordered_maps
-		//	do so through key allocation. Deleter defines the map and a mutex to
-		//	protect it. It also serves as a functor that is passed to the
-		//	shared_ptr to handle deallocation which, in this case, means erasing
-		//	the relevant entry from the map.
-		template<typename T, typename Tuple>
-			struct Deleter {
-				static inline TMap<T,Tuple> gMap;
-				static inline TMutex gMutex;
+		//	MakeProbe() picks the cheapest View it can safely use for args.
+		template<typename T, typename Tuple, typename Policy, typename... Args>
+			auto MakeProbe(Args&&... args) {
+				using TArgs = std::tuple<Args&&...>;
+				constexpr bool kOneArg = sizeof...(Args) == 1;
+				if constexpr(
+					kOneArg && (std::is_same_v<std::decay_t<Args>,T> && ...)
+					)
+				{
+					return Probe<T,Tuple,Policy,const T&,Args...>{
+						args..., TArgs{std::forward<Args>(args)...}
+						};
+				}
+				else if constexpr(
+					std::is_void_v<Tuple> &&
+					!std::is_void_v<typename StringView<T>::Type> &&
+					kOneArg && (
+						std::is_convertible_v<
+							Args, typename StringView<T>::Type
+							> && ...
+						)
+					)
+				{
+					using TView = typename StringView<T>::Type;
+					return Probe<T,Tuple,Policy,TView,Args...>{
+						TView(args...), TArgs{std::forward<Args>(args)...}
+						};
+				}
+				else if constexpr(
+					!std::is_void_v<Tuple> && Policy::kTupleArgs &&
+					IsBraceConstructible<Tuple,void,const Args&...>::value
+					)
+				{
+					return Probe<T,Tuple,Policy,Tuple,Args...>{
+						Tuple{std::as_const(args)...},
+						TArgs{std::forward<Args>(args)...}
+						};
+				}
+				else {
+					return Probe<T,Tuple,Policy,T>{
+						Construct<T>(std::forward<Args>(args)...), {}
+						};
+				}
+			}
+
+		//	NullMutex stands in for std::mutex under policy::SingleThread.
+		struct NullMutex {
+			void lock() noexcept {}
+			auto try_lock() noexcept { return true; }
+			void unlock() noexcept {}
+		};
+
+		//	TimedMutex is std::mutex under policy::WithStats. When lock() finds
+		//	the mutex taken, it times the wait. (The tallies are only touched
+		//	while the mutex is held, so they need not be atomic.)
+		struct TimedMutex {
+			std::mutex mutex;
+			std::uint64_t waits = 0;
+			std::uint64_t waitNs = 0;
+
+			void lock() {
+				if(mutex.try_lock()) {
+					return;
+				}
+				auto t0 = std::chrono::steady_clock::now();
+				mutex.lock();
+				auto dt = std::chrono::steady_clock::now() - t0;
+				++waits;
+				waitNs += static_cast<std::uint64_t>(
+					std::chrono::duration_cast<std::chrono::nanoseconds>(
+						dt
+						).count()
+					);
+			}
+			auto try_lock() { return mutex.try_lock(); }
+			void unlock() { mutex.unlock(); }
+		};
 
-				void operator()(const T* p) const {
-				 #if INTERN_DEBUG
-					std::cout << "erase interned\n";
-				 #endif
-					std::lock_guard<TMutex> lg{gMutex};
-					gMap.erase(*p);
+		template<typename Policy>
+			using TMutex = std::conditional_t<
+				Policy::kThreadSafe,
+				std::conditional_t<Policy::kStats, TimedMutex, std::mutex>,
+				NullMutex
+				>;
+
+		//	Unsynced likewise stands in for std::atomic. It supports just the
+		//	operations the table needs, ignoring their memory orders.
+		template<typename V>
+			class Unsynced {
+			public:
+				constexpr Unsynced() noexcept: mValue{} {}
+				constexpr Unsynced(V v) noexcept: mValue{v} {}
+				Unsynced(const Unsynced&) = delete;
+				auto operator = (const Unsynced&) = delete;
+
+				auto load(std::memory_order = {}) const noexcept -> V {
+					return mValue;
+				}
+				void store(V v, std::memory_order = {}) noexcept {
+					mValue = v;
+				}
+				auto exchange(V v, std::memory_order = {}) noexcept -> V {
+					return std::exchange(mValue, v);
+				}
+				auto fetch_add(V v, std::memory_order = {}) noexcept -> V {
+					return std::exchange(mValue, mValue + v);
+				}
+				auto fetch_sub(V v, std::memory_order = {}) noexcept -> V {
+					return std::exchange(mValue, mValue - v);
+				}
+				auto compare_exchange_weak(
+					V& expected, V desired, std::memory_order = {}
+					) noexcept
+				{
+					if(mValue != expected) {
+						expected = mValue;
+						return false;
+					}
+					mValue = desired;
+					return true;
 				}
+
+			private:
+				V mValue;
 			};
-	}
 
-	//---- Internment Utilities  -----------------------------------------------
-	//
-	//	MakeInterned<T,Tuple=void>(args...) -> std::shared_ptr<const T>:
-	//		Returns a shared pointer to an immutable type T initialized with
-	//		any args you supply. MakeInterned() checks if a pointer with those
-	//		same args is already in use, in which case it returns said pointer
-	//		rather than allocating a fresh one.
-	//
-	//		By default, the data type T needs to be hashable and equality-
-	//		comparable. That's because MakeInterned() tracks objects in an
-	//		internal unordered_map with key type T. While this might be fine for
-	//		built-in classes like std::string that already meet these criteria,
-	//		it can be a bit onerous to add this functionality to custom classes
-	//		you are writing. This is where the Tuple template arg may help?
-	//
-	//		If you supply Tuple, it should be a tuple-like data type such as
-	//		std::tuple, std::pair, or std::array in which every element is
-	//		hashable and equality-comparable. By supplying this template arg,
-	//		you are telling MakeInterned() that your class can be static_cast
-	//		to that type. (It may inherit from the tuple class or implement a
-	//		conversion operator.) MakeInterned() can then hash/compare your T
-	//		values in tuple form, meaning you need not implement std::hash<T>
-	//		and so on.
+		template<typename Policy, typename V>
+			using TAtomic = std::conditional_t<
+				Policy::kThreadSafe, std::atomic<V>, Unsynced<V>
+				>;
 
-	template<typename T, typename Tuple=void, typename... Args>
-		auto MakeInterned(Args&&... args) {
+		//	A StatsBook keeps the event counts for one table (as identified by
+		//	its Ref type). Each thread counts into a Block of its own, which
+		//	only it writes, and which is folded into the retired totals when
+		//	the thread exits. Sum() adds up the lot.
+		template<typename Policy, typename Ref>
+			struct StatsBook {
+				static constexpr std::size_t kEvents = 3;
 
-			using D = details::Deleter<T,Tuple>;
-			std::shared_ptr<const T> shPtr;
-
-			//	Instantiate a temporary local T variable with the input args.
-			T key{std::forward<Args>(args)...};
-
-			//	Attempt to place the variable as a key in the global map.
-			std::lock_guard<details::TMutex> lg{D::gMutex};
-			if(auto [it, done] = D::gMap.try_emplace(std::move(key)); done) {
-				
-				//	Succeeding means we have yet to encounter the object.
-				//	The key should now be in place, but the weak pointer would
-				//	still be null. We need to create a shared pointer that
-				//	points to where the key is now in the map and assign that
-				//	pointer to the weak pointer value. This shared pointer will
-				//	use a custom deleter which, rather than deallocating it in
-				//	the traditional way, will remove the entry from the map.
-				
-			 #if INTERN_DEBUG
-				std::cout << "intern\n";
-			 #endif
-				shPtr = decltype(shPtr)(&it->first, D{});
-				it->second = shPtr;
+				using Counts = std::array<std::uint64_t,kEvents>;
+
+				struct Block {
+					TAtomic<Policy,std::uint64_t> counts[kEvents]{};
+
+					Block() {
+						auto& reg = Registry();
+						std::lock_guard<std::mutex> lg{reg.mutex};
+						reg.blocks.push_back(this);
+					}
+					Block(const Block&) = delete;
+					auto operator = (const Block&) = delete;
+					~Block() {
+						auto& reg = Registry();
+						std::lock_guard<std::mutex> lg{reg.mutex};
+						for(std::size_t i = 0; i < kEvents; ++i) {
+							reg.retired[i] += counts[i].load();
+						}
+						reg.blocks.erase(std::find(
+							reg.blocks.begin(), reg.blocks.end(), this
+							));
+					}
+				};
+				struct Books {
+					std::mutex mutex;
+					std::vector<Block*> blocks;
+					Counts retired{};
+				};
+
+				static void Add(Event event) {
+					thread_local Block block;
+					auto& n = block.counts[static_cast<std::size_t>(event)];
+					n.store(n.load(std::memory_order_relaxed) + 1u,
+						std::memory_order_relaxed);
+				}
+				static auto Sum() -> Counts {
+					auto& reg = Registry();
+					std::lock_guard<std::mutex> lg{reg.mutex};
+					auto sum = reg.retired;
+					for(auto block: reg.blocks) {
+						for(std::size_t i = 0; i < kEvents; ++i) {
+							sum[i] += block->counts[i].load(
+								std::memory_order_relaxed
+								);
+						}
+					}
+					return sum;
+				}
+
+				//	(The registry is never destroyed, since tables may still
+				//	be erasing entries, and so counting, as static objects
+				//	are torn down at exit.)
+				static auto Registry() -> Books& {
+					static auto& books = *new Books;
+					return books;
+				}
+			};
+
+		//	Note() counts an event with policy::WithStats and passes it on to
+		//	the policy's Tracer, if any. Otherwise, it does nothing.
+		template<typename T, typename Policy, typename Ref>
+			void Note(Event event, std::size_t hash) {
+				if constexpr(Policy::kStats) {
+					StatsBook<Policy,Ref>::Add(event);
+				}
+				if constexpr(!std::is_void_v<typename Policy::Tracer>) {
+					Policy::Tracer::Trace(TraceRecord{event, &typeid(T), hash});
+				}
 			}
-			else {
-				//	Failing means an identical key is already in the map.
-				//	This is a good thing! We can make a shared pointer out
-				//	of the weak pointer and return that without any further
-				//	allocations.
-			 #if INTERN_DEBUG
-				std::cout << "fetch interned\n";
-			 #endif
-				shPtr = it->second.lock();
+
+		//	A ShardCensus is a shard's contribution to TableStats.
+		struct ShardCensus {
+			std::size_t size = 0;
+			std::size_t capacity = 0;
+			std::size_t bytes = 0;
+			std::uint64_t lockWaits = 0;
+			std::uint64_t lockWaitNs = 0;
+		};
+
+		//	CountWaits() copies a TimedMutex's tallies into census. The
+		//	caller must hold the mutex. (Other mutexes have none to copy.)
+		template<typename Mutex>
+			void CountWaits(const Mutex& mutex, ShardCensus& census) {
+				if constexpr(std::is_same_v<Mutex,TimedMutex>) {
+					census.lockWaits = mutex.waits;
+					census.lockWaitNs = mutex.waitNs;
+				}
 			}
-			return std::move(shPtr);
+
+		//	Shards are aligned to this many bytes so that neighbouring mutexes
+		//	do not share a cache line.
+		constexpr std::size_t kCacheLine = 64;
+
+		//	Prefetch() hints that the memory at p will be read soon. Batch
+		//	interning uses it to overlap cache misses on upcoming elements.
+		inline void Prefetch(const void* p) noexcept {
+		 #if defined(__GNUC__)
+			__builtin_prefetch(p);
+		 #elif INTERN_SSE2
+			_mm_prefetch(static_cast<const char*>(p), _MM_HINT_T0);
+		 #else
+			static_cast<void>(p);
+		 #endif
 		}
+
+		template<typename T, typename Tuple, typename Policy>
+			struct Deleter;
+
+		//	A Ref type determines what sort of reference MakeInterned() and
+		//	friends return: its Result. It also supplies the Data an Entry
+		//	stores to make this possible. Given an Entry, Acquire() returns a
+		//	new reference if the entry is still alive (or a null Result if it is
+		//	being erased), while Adopt() sets up the first reference to a
+		//	freshly inserted (or revived) entry. kCounted says whether the
+		//	references are counted, such that the entry is released once the
+		//	last one goes. kHashed says whether each Entry stores its hash,
+		//	and ValueHash hashes a T the way the table does, for when it does
+		//	not (see policy::Compact).
+		//
+		//	SharedRef hands out std::shared_ptr with Deleter (see below), and
+		//	keeps a weak pointer in each Entry.
+		template<typename T, typename Tuple, typename Policy>
+			struct SharedRef {
+				using Data = std::weak_ptr<const T>;
+				using Result = std::shared_ptr<const T>;
+				using TEntry = Entry<T,SharedRef>;
+				using ValueHash = typename Map<T,Tuple,Policy>::Hash;
+
+				static constexpr bool kHashed = !Policy::kCompact;
+				static constexpr bool kCounted = true;
+
+				static auto Acquire(TEntry& entry) -> Result {
+					return entry.ref.lock();
+				}
+				static auto Adopt(TEntry& entry) -> Result {
+					Result shPtr(&entry.value, Deleter<T,Tuple,Policy>{&entry});
+					entry.ref = shPtr;
+					return shPtr;
+				}
+			};
+
+		//	HandleRef hands out intern::Handle, and keeps an intrusive
+		//	reference count in each Entry. (Release() is called by Handle once
+		//	it has dropped the count to zero. Re-adopting an entry whose count
+		//	has dropped to zero brings it back to life.)
+		template<typename T, typename Tuple, typename Policy>
+			struct HandleRef {
+				using Data = TAtomic<Policy,std::uint32_t>;
+				using Result = Handle<T,Tuple,Policy>;
+				using TEntry = Entry<T,HandleRef>;
+				using ValueHash = typename Map<T,Tuple,Policy>::Hash;
+
+				static constexpr bool kHashed = !Policy::kCompact;
+				static constexpr bool kCounted = true;
+
+				static auto Acquire(TEntry& entry) -> Result {
+					auto n = entry.ref.load(std::memory_order_relaxed);
+					while(n && !entry.ref.compare_exchange_weak(
+						n, n + 1u, std::memory_order_relaxed
+						)) {}
+					return n ? Result{&entry} : Result{};
+				}
+				static auto Adopt(TEntry& entry) -> Result {
+					entry.ref.store(1u, std::memory_order_relaxed);
+					return Result{&entry};
+				}
+				static void Release(TEntry& entry);
+			};
+
+		//	A SlotTable maps 32-bit indices to entry pointers for IdRef. Index
+		//	0 is never handed out, so that it can mean "no entry". The slots
+		//	live in chunks that double in size (the first holding kFirst), and
+		//	chunks never move once allocated, so At() needs no lock. Add() and
+		//	Remove() serialize on the table's mutex, recycling freed indices.
+		//	Remove() also zeroes the entry's own copy of the index before the
+		//	index can be reused, and returns the entry (or null if the slot
+		//	was already empty).
+		template<typename Policy, typename TEntry>
+			struct SlotTable {
+				using Slot = TAtomic<Policy,TEntry*>;
+
+				static constexpr std::uint32_t kFirst = 256;
+				static constexpr int kChunks = 25;  // enough for 2^32 slots
+
+				std::array<TAtomic<Policy,Slot*>,kChunks> chunks{};
+				TMutex<Policy> mutex;
+				std::vector<std::uint32_t> freed;
+				std::uint32_t next = 1;
+
+				SlotTable() = default;
+				SlotTable(const SlotTable&) = delete;
+				auto operator = (const SlotTable&) = delete;
+				~SlotTable() {
+					for(auto& chunk: chunks) {
+						delete[] chunk.load();
+					}
+				}
+
+				auto At(std::uint32_t i) const -> TEntry* {
+					auto [k, j] = Locate(i);
+					return chunks[k].load(std::memory_order_acquire)[j].load(
+						std::memory_order_acquire
+						);
+				}
+				auto Add(TEntry* p) -> std::uint32_t {
+					std::lock_guard<TMutex<Policy>> lg{mutex};
+					std::uint32_t i;
+					if(freed.empty()) {
+						if(next == 0) {
+							throw std::length_error{"out of 32-bit ids"};
+						}
+						i = next++;
+					}
+					else {
+						i = freed.back();
+						freed.pop_back();
+					}
+					auto [k, j] = Locate(i);
+					auto chunk = chunks[k].load(std::memory_order_relaxed);
+					if(!chunk) {
+						chunk = new Slot[std::size_t{kFirst} << k]{};
+						chunks[k].store(chunk, std::memory_order_release);
+					}
+					chunk[j].store(p, std::memory_order_release);
+					return i;
+				}
+				auto Remove(std::uint32_t i) -> TEntry* {
+					std::lock_guard<TMutex<Policy>> lg{mutex};
+					if(i == 0 || i >= next) {
+						return nullptr;
+					}
+					auto [k, j] = Locate(i);
+					auto& slot = chunks[k].load(std::memory_order_relaxed)[j];
+					auto p = slot.exchange(nullptr, std::memory_order_relaxed);
+					if(p) {
+						p->ref.store(0u, std::memory_order_release);
+						freed.push_back(i);
+					}
+					return p;
+				}
+
+				//	Chunk k holds indices [kFirst * (2^k - 1), kFirst *
+				//	(2^(k+1) - 1)). Returns k and the offset within it.
+				static auto Locate(std::uint32_t i)
+					-> std::pair<int,std::size_t>
+				{
+					std::uint64_t n = i / kFirst + 1;
+					int k = 0;
+					while(n >> (k + 1)) {
+						++k;
+					}
+					auto start = std::uint64_t{kFirst} * ((1ull << k) - 1u);
+					return {k, static_cast<std::size_t>(i - start)};
+				}
+			};
+
+		//	IdRef hands out intern::Id. Each Entry stores the index of its slot
+		//	in the SlotTable, or 0 once it has been unpinned. Ids are not
+		//	counted: an entry stays put until Unpin() erases it.
+		template<typename T, typename Tuple, typename Policy>
+			struct IdRef {
+				using Data = TAtomic<Policy,std::uint32_t>;
+				using Result = Id<T,Tuple,Policy>;
+				using TEntry = Entry<T,IdRef>;
+				using ValueHash = typename Map<T,Tuple,Policy>::Hash;
+
+				static constexpr bool kHashed = !Policy::kCompact;
+				static constexpr bool kCounted = false;
+
+				static inline SlotTable<Policy,TEntry> gSlots;
+
+				static auto Acquire(TEntry& entry) -> Result {
+					return Result{entry.ref.load(std::memory_order_acquire)};
+				}
+				static auto Adopt(TEntry& entry) -> Result {
+					auto i = gSlots.Add(&entry);
+					entry.ref.store(i, std::memory_order_release);
+					return Result{i};
+				}
+				static void Unpin(Result id);
+			};
+
+		//	PoolRef hands out plain pointers for intern::Pool. An entry lives
+		//	as long as its pool does, so there is nothing to count.
+		template<typename T, typename Tuple, typename Policy>
+			struct PoolRef {
+				struct Data {};
+				using Result = const T*;
+				using TEntry = Entry<T,PoolRef>;
+				using ValueHash = typename Map<T,Tuple,Policy>::Hash;
+
+				static constexpr bool kHashed = !Policy::kCompact;
+				static constexpr bool kCounted = false;
+
+				static auto Acquire(TEntry& entry) -> Result {
+					return &entry.value;
+				}
+				static auto Adopt(TEntry& entry) -> Result {
+					return &entry.value;
+				}
+			};
+
+		//	PoolPolicy adapts a Policy for intern::Pool, whose shards allocate
+		//	from arenas through a polymorphic allocator.
+		template<typename Policy>
+			struct PoolPolicy: Policy {
+				static constexpr bool kPooled = false;
+				using Allocator = std::pmr::polymorphic_allocator<std::byte>;
+			};
+
+		//	ShardMemory is a base class of every shard type. It supplies the
+		//	allocator the shard uses for its entries, which is normally default-
+		//	constructed but may be passed in (as intern::Pool does). With
+		//	policy::PooledNodes, it also owns the pool resource that allocator
+		//	draws from. (Being a base class ensures the pool outlives everything
+		//	allocated from it.)
+		template<typename Policy, bool kPooled = Policy::kPooled>
+			struct ShardMemory {
+				using Allocator = typename Policy::Allocator;
+
+				Allocator allocator{};
+
+				ShardMemory() = default;
+				explicit ShardMemory(const Allocator& alloc): allocator{alloc} {}
+			};
+		template<typename Policy>
+			struct ShardMemory<Policy,true> {
+				using Allocator = std::pmr::polymorphic_allocator<std::byte>;
+
+				std::pmr::unsynchronized_pool_resource pool;
+				Allocator allocator{&pool};
+			};
+
+		//	Retention is the ring of recently released objects kept alive by
+		//	policy::Retain. Each shard has one (which is empty without the
+		//	policy), guarded by the shard's mutex. Push() adds a reference and
+		//	returns the one it displaced, if any, which the caller must hand to
+		//	Evict() after unlocking the mutex. Evict() drops the reference with
+		//	tEvicting set, which tells Table::Release() that the entry should be
+		//	erased rather than retained again. (Release() clears the flag, so
+		//	objects destroyed as a side effect of erasing are still retained.)
+		template<typename Ref, std::size_t N>
+			struct Retention {
+				using Result = typename Ref::Result;
+
+				static inline thread_local bool tEvicting = false;
+
+				std::vector<Result> ring;
+				std::size_t next = 0;
+
+				Retention() = default;
+				Retention(const Retention&) = delete;
+				auto operator = (const Retention&) = delete;
+				~Retention() {
+					Clear();
+				}
+
+				//	Shards with destructors of their own call Clear() first,
+				//	while their entries can still be erased. (Erasing one may
+				//	release others, which land in a fresh ring.) It returns
+				//	whether there was anything to clear.
+				auto Clear() -> bool {
+					bool any = !ring.empty();
+					while(!ring.empty()) {
+						auto old = std::move(ring);
+						ring.clear();
+						next = 0;
+						for(auto& result: old) {
+							Evict(std::move(result));
+						}
+					}
+					return any;
+				}
+
+				auto Push(Result result) -> Result {
+					if(ring.size() < N) {
+						ring.push_back(std::move(result));
+						return {};
+					}
+					auto victim = std::exchange(ring[next], std::move(result));
+					next = (next + 1) % N;
+					return victim;
+				}
+				static void Evict(Result victim) {
+					tEvicting = true;
+					victim.reset();
+					tEvicting = false;
+				}
+			};
+		template<typename Ref>
+			struct Retention<Ref,0> {
+				auto Clear() -> bool {
+					return false;
+				}
+			};
+
+		//	Claim() returns a new reference to an entry matching a look-up.
+		//	If the entry's last reference is gone but it has yet to be
+		//	erased, it gives a null Result, unless kRevive is set. In that
+		//	case, it adopts the entry again on the spot, so that a hit never
+		//	has to wait for the erasure and insert a replacement. The erasure
+		//	will later see the revival (see Spare()) and leave the entry be.
+		//	kRevive requires the shard's mutex, and has no effect for
+		//	uncounted Refs.
+		template<bool kRevive, typename T, typename Policy, typename Ref>
+			auto Claim(std::size_t hash, Entry<T,Ref>& entry)
+				-> typename Ref::Result
+			{
+				auto result = Ref::Acquire(entry);
+				if constexpr(kRevive && Ref::kCounted) {
+					if(!result) {
+						++entry.revivals;
+						result = Ref::Adopt(entry);
+					}
+				}
+				if(result) {
+					Note<T,Policy,Ref>(Event::kFetch, hash);
+				}
+				return result;
+			}
+
+		//	A shard calls Spare() on an entry it is about to erase. If the
+		//	entry was revived since the release that led here, this uses up
+		//	one revival and returns true, and the entry must be kept. The
+		//	shard's mutex must be held.
+		template<typename T, typename Ref>
+			auto Spare(Entry<T,Ref>& entry) -> bool {
+				if(entry.revivals) {
+					--entry.revivals;
+					return true;
+				}
+				return false;
+			}
+
+		//	HashMatches() is a cheap first test of whether entry might match
+		//	a probe with the given hash. Without a stored hash, it has to
+		//	pass everything on to the probe, which then compares the objects
+		//	themselves. So every slot a look-up can reach must hold a live
+		//	entry (see FlatShard::Migrate()).
+		template<typename T, typename Ref>
+			auto HashMatches(const Entry<T,Ref>& entry, std::size_t hash)
+				-> bool
+			{
+				if constexpr(Ref::kHashed) {
+					return entry.hash == hash;
+				}
+				else {
+					return true;
+				}
+			}
+
+		//	Erasing an entry destroys its object under the shard's mutex. If
+		//	that object held the last reference to another entry in the same
+		//	table (one of the parts of a hash-consed value, say), releasing
+		//	that entry on the spot would lock the mutex again, or another
+		//	shard's while holding this one. So a shard erases under an
+		//	EraseGuard, declared ahead of its lock. Table::Release() defers
+		//	any release made on the thread while a guard is held, and the
+		//	outermost guard carries them out as it goes, once the mutex is
+		//	unlocked. Those may erase more entries in turn, whose own
+		//	releases join the queue, so that a long chain unravels in a loop
+		//	rather than by recursion.
+		template<typename T, typename Tuple, typename Policy, typename Ref>
+			struct EraseGuard {
+				//	Each release is queued with whether it was an eviction
+				//	(see Retention) and the function that carries it out.
+				//	(The guard is declared by every shard, so it must not
+				//	instantiate Table::ReleaseNow() itself for tables that
+				//	never release anything.)
+				using TEntry = typename Ref::TEntry;
+				using Release = void(*)(TEntry&, bool);
+				using Queue = std::vector<std::tuple<TEntry*,bool,Release>>;
+
+				static inline thread_local Queue* tQueue = nullptr;
+
+				Queue queue;
+				bool outer = !tQueue;
+
+				EraseGuard() {
+					if(outer) {
+						tQueue = &queue;
+					}
+				}
+				EraseGuard(const EraseGuard&) = delete;
+				auto operator = (const EraseGuard&) = delete;
+				~EraseGuard() {
+					while(outer && !queue.empty()) {
+						auto [entry, evicting, release] = queue.back();
+						queue.pop_back();
+						release(*entry, evicting);
+					}
+					if(outer) {
+						tQueue = nullptr;
+					}
+				}
+
+				//	Defer() queues a release if the thread holds a guard, and
+				//	returns whether it did.
+				static auto Defer(TEntry& entry, bool evicting, Release release)
+					-> bool
+				{
+					if(tQueue) {
+						tQueue->emplace_back(&entry, evicting, release);
+						return true;
+					}
+					return false;
+				}
+			};
+
+		//	MapShard is the default shard type: a map guarded by a mutex that
+		//	is held for every look-up, insertion, and erasure.
+		template<typename T, typename Tuple, typename Policy, typename Ref>
+			struct alignas(kCacheLine) MapShard: ShardMemory<Policy> {
+				using TTMap =
+					TMap<T, Ref, typename ShardMemory<Policy>::Allocator>;
+				using ShardMemory<Policy>::ShardMemory;
+
+				static_assert(
+					Policy::kRehashStep == 0,
+					"policy::IncrementalRehash requires FlatTable"
+					);
+
+				TTMap map{NewMap(this->allocator)};
+				TMutex<Policy> mutex;
+				Retention<Ref,Ref::kCounted ? Policy::kRetain : 0> retention;
+
+				template<typename Probe>
+					auto Intern(std::size_t hash, Probe& probe)
+						-> typename Ref::Result
+					{
+						std::lock_guard<TMutex<Policy>> lg{mutex};
+						return InternLocked(hash, probe);
+					}
+
+				//	TryIntern() is Intern() except that, rather than wait for
+				//	the mutex, it returns a null Result.
+				template<typename Probe>
+					auto TryIntern(std::size_t hash, Probe& probe)
+						-> typename Ref::Result
+					{
+						std::unique_lock<TMutex<Policy>> lk{
+							mutex, std::try_to_lock
+							};
+						if(!lk) {
+							return {};
+						}
+						return InternLocked(hash, probe);
+					}
+
+				//	InternLocked() is Intern() for callers already holding the
+				//	mutex, such as batch interning.
+				template<typename Probe>
+					auto InternLocked(std::size_t hash, Probe& probe)
+						-> typename Ref::Result
+					{
+						if(auto result = Lookup<true>(hash, probe)) {
+							return result;
+						}
+
+						//	Failing means we have yet to encounter the object.
+						//	We emplace a new entry, but it has no references
+						//	yet. With SharedRef, we need to create a shared
+						//	pointer that points to where the value is now in
+						//	the map and assign that pointer to the entry's weak
+						//	pointer. This shared pointer will use a custom
+						//	deleter which, rather than deallocating it in the
+						//	traditional way, will remove the entry from the
+						//	map. (HandleRef works the same way, except that the
+						//	count lives in the entry itself.)
+						Note<T,Policy,Ref>(Event::kIntern, hash);
+						auto it = map.emplace(
+							std::piecewise_construct,
+							std::forward_as_tuple(hash),
+							std::tuple_cat(
+								std::forward_as_tuple(hash), probe.EntryArgs()
+								)
+							);
+						return Ref::Adopt(it->second);
+					}
+
+				//	Lookup() returns a reference to a live entry matching
+				//	probe, if there is one. With kRevive, an entry waiting to
+				//	be erased counts as live (see Claim()). The mutex must be
+				//	held.
+				template<bool kRevive=false, typename Probe>
+					auto Lookup(std::size_t hash, const Probe& probe)
+						-> typename Ref::Result
+					{
+						for(auto [it, end] = map.equal_range(hash);
+							it != end; ++it)
+						{
+							//	Finding it means an identical object is
+							//	already in the map. This is a good thing! We
+							//	can make a new reference to it (e.g. a shared
+							//	pointer out of a weak pointer) and return that
+							//	without allocating another entry, even if its
+							//	last reference has already expired and it is
+							//	only waiting to be erased.
+							if(probe.Matches(it->second.value)) {
+								if(auto result =
+									Claim<kRevive,T,Policy>(
+										hash, it->second
+										))
+								{
+									return result;
+								}
+							}
+						}
+						return {};
+					}
+
+				//	There is no way to get at a bucket's memory through the
+				//	std::unordered_multimap interface, so this does nothing.
+				void Prefetch(std::size_t) const noexcept {}
+
+				//	Reserve() makes room for n entries without rehashing.
+				void Reserve(std::size_t n) {
+					std::lock_guard<TMutex<Policy>> lg{mutex};
+					map.reserve(n);
+				}
+
+				//	Census() reports the shard's size and (estimated) memory
+				//	footprint for Stats().
+				auto Census() -> ShardCensus {
+					std::lock_guard<TMutex<Policy>> lg{mutex};
+					ShardCensus census;
+					census.size = map.size();
+					census.capacity = map.bucket_count();
+
+					//	Each node also holds a next pointer and a cached hash.
+					census.bytes = sizeof *this +
+						census.size * (
+							sizeof(typename TTMap::value_type) +
+							2 * sizeof(void*)
+							) +
+						census.capacity * sizeof(void*);
+					CountWaits(mutex, census);
+					return census;
+				}
+
+				//	ForEach() calls f(entry) for every Entry in the shard,
+				//	including any waiting to be erased, under the mutex.
+				template<typename F>
+					void ForEach(F&& f) {
+						std::lock_guard<TMutex<Policy>> lg{mutex};
+						for(auto& [hash, entry]: map) {
+							f(entry);
+						}
+					}
+
+				//	Purge() lets the Retention ring go before the table is
+				//	destroyed (see Table::Shards). Since erasing what was in
+				//	it may fill another shard's ring, it returns whether there
+				//	was anything.
+				auto Purge() -> bool {
+					return retention.Clear();
+				}
+
+				void Erase(std::size_t hash, const T* p) {
+					EraseGuard<T,Tuple,Policy,Ref> eg;
+					std::lock_guard<TMutex<Policy>> lg{mutex};
+					EraseLocked(hash, p);
+				}
+				template<typename It>
+					void EraseAll(It first, It last) {
+						EraseGuard<T,Tuple,Policy,Ref> eg;
+						std::lock_guard<TMutex<Policy>> lg{mutex};
+						for(; first != last; ++first) {
+							EraseLocked(first->first, first->second);
+						}
+					}
+
+			private:
+				static auto NewMap(
+					const typename ShardMemory<Policy>::Allocator& alloc
+					) -> TTMap
+				{
+					TTMap m{typename TTMap::allocator_type{alloc}};
+					if constexpr(Policy::kMaxLoad != 0) {
+						m.max_load_factor(Policy::kMaxLoad / 100.0f);
+					}
+					return m;
+				}
+
+				void EraseLocked(std::size_t hash, const T* p) {
+					//	Several entries may share a hash value, so we look for
+					//	the one whose value p points to.
+					auto it = map.equal_range(hash).first;
+					while(&it->second.value != p) {
+						++it;
+					}
+					if(Spare(it->second)) {
+						return;
+					}
+					Note<T,Policy,Ref>(Event::kErase, hash);
+					map.erase(it);
+				}
+			};
+
+		//	Mix() scrambles a raw hash before a shard derives a slot index from
+		//	it, since std::hash is often the identity function for integers.
+		//	Keys that differ only in their higher bits would otherwise pile up
+		//	in the same few slots.
+		inline auto Mix(std::size_t hash) -> std::size_t {
+			constexpr std::size_t kMagic =
+				sizeof(std::size_t) * CHAR_BIT > 32u ?
+				0x9e3779b97f4a7c15 : 0x9e3779b9;
+			hash *= kMagic;
+			return hash ^ (hash >> (sizeof(std::size_t) * CHAR_BIT / 2));
+		}
+
+		//	LockFreeShard lets look-ups that hit proceed without taking the
+		//	mutex. Only insertions and erasures lock it.
+		//
+		//	Entries are individually allocated Nodes, tracked by an open-
+		//	addressing (linear probing) array of atomic Node pointers, indexed
+		//	by mixed hash (see Mix()). Erased
+		//	slots are marked with a tombstone rather than emptied so that
+		//	probe sequences stay intact for concurrent readers. When the array
+		//	grows too full (counting tombstones), a fresh one is built and
+		//	swapped in.
+		//
+		//	The catch is that a reader may still be looking at a Node (or the
+		//	old array) after a writer has unlinked it. So rather than deleting
+		//	these right away, writers retire them to a limbo list and only
+		//	free them after a grace period. This works with a pair of reader
+		//	counters indexed by the parity of an epoch number. Readers bump the
+		//	counter for the current epoch while they probe. A writer that wants
+		//	to free what was retired in epoch e first advances the epoch to
+		//	e + 1. Once the counter for e drains to zero, no reader can still
+		//	be holding anything unlinked during e. (Writers never wait for this
+		//	to happen. They just check each time they retire something.)
+		template<typename T, typename Tuple, typename Policy, typename Ref>
+			struct alignas(kCacheLine) LockFreeShard: ShardMemory<Policy> {
+				static_assert(
+					Policy::kThreadSafe,
+					"LockFreeReads cannot be combined with SingleThread"
+					);
+				static_assert(
+					Policy::kRehashStep == 0,
+					"policy::IncrementalRehash requires FlatTable"
+					);
+
+				using Node = details::Node<T,Ref>;
+				struct Slots {
+					std::size_t mask;
+					std::unique_ptr<std::atomic<Node*>[]> at;
+
+					explicit Slots(std::size_t capacity):
+						mask{capacity - 1},
+						at{new std::atomic<Node*>[capacity]}
+					{
+						for(std::size_t i = 0; i < capacity; ++i) {
+							at[i].store(nullptr, std::memory_order_relaxed);
+						}
+					}
+				};
+				struct Limbo {
+					std::vector<Node*> nodes;
+					std::vector<Slots*> slots;
+				};
+
+				static constexpr std::size_t kMinCapacity = 16;
+				static constexpr std::size_t kMaxLoad =
+					Policy::kMaxLoad != 0 ? Policy::kMaxLoad : 50;
+
+				//	Reviving an entry under SharedRef means storing a new weak
+				//	pointer in it while lock-free readers may be reading the
+				//	old one, so a replacement is inserted instead.
+				static constexpr bool kRevive =
+					!std::is_same_v<Ref, SharedRef<T,Tuple,Policy>>;
+
+				using ShardMemory<Policy>::ShardMemory;
+
+				//	Read-side state goes on its own cache line, since readers
+				//	modify it without holding the mutex.
+				alignas(kCacheLine) std::atomic<std::size_t> readers[2]{};
+				std::atomic<unsigned> epoch{0};
+				std::atomic<Slots*> slots{nullptr};
+
+				//	Everything below is guarded by the mutex.
+				alignas(kCacheLine) TMutex<Policy> mutex;
+				std::size_t count = 0;  // live nodes
+				std::size_t used = 0;  // live nodes + tombstones
+				Limbo limbo[2];
+				Retention<Ref,Ref::kCounted ? Policy::kRetain : 0> retention;
+
+				LockFreeShard() = default;
+				LockFreeShard(const LockFreeShard&) = delete;
+				auto operator = (const LockFreeShard&) = delete;
+				~LockFreeShard() {
+					while(Purge()) {}
+					if(auto pSlots = slots.load()) {
+						for(std::size_t i = 0; i <= pSlots->mask; ++i) {
+							if(auto p = pSlots->at[i].load(); p && p != Tomb()) {
+								DeleteNode(p);
+							}
+						}
+						delete pSlots;
+					}
+					for(auto& lim: limbo) {
+						Free(lim);
+					}
+				}
+
+				template<typename Probe>
+					auto Intern(std::size_t hash, Probe& probe)
+						-> typename Ref::Result
+					{
+						//	Optimistically look for the object without locking.
+						//	The Node must not be touched once the ReadGuard is
+						//	gone, since it may then be freed at any time.
+						{
+							ReadGuard rg{*this};
+							if(auto result = Lookup(hash, probe)) {
+								return result;
+							}
+						}
+
+						//	On a miss, we need to look again under the lock in
+						//	case another thread inserted it in the meantime.
+						std::lock_guard<TMutex<Policy>> lg{mutex};
+						return InternLocked(hash, probe);
+					}
+
+				//	TryIntern() is Intern() except that, rather than wait for
+				//	the mutex on a miss, it returns a null Result.
+				template<typename Probe>
+					auto TryIntern(std::size_t hash, Probe& probe)
+						-> typename Ref::Result
+					{
+						{
+							ReadGuard rg{*this};
+							if(auto result = Lookup(hash, probe)) {
+								return result;
+							}
+						}
+						std::unique_lock<TMutex<Policy>> lk{
+							mutex, std::try_to_lock
+							};
+						if(!lk) {
+							return {};
+						}
+						return InternLocked(hash, probe);
+					}
+
+				//	InternLocked() is the locked half of Intern(), for callers
+				//	already holding the mutex, such as batch interning.
+				template<typename Probe>
+					auto InternLocked(std::size_t hash, Probe& probe)
+						-> typename Ref::Result
+					{
+						if(auto result = Lookup<kRevive>(hash, probe)) {
+							return result;
+						}
+						Note<T,Policy,Ref>(Event::kIntern, hash);
+						ReserveLocked(count + 1);
+						auto p = std::apply(
+							[this, hash](auto&&... args) {
+								return NewNode(
+									hash, std::forward<decltype(args)>(args)...
+									);
+							},
+							probe.EntryArgs()
+							);
+
+						//	The first reference must be in place before the
+						//	Node is published, since readers will acquire it.
+						auto result = Ref::Adopt(p->entry);
+						auto pSlots = slots.load();
+						for(auto i = Mix(hash);; ++i) {
+							auto& slot = pSlots->at[i & pSlots->mask];
+							auto q = slot.load();
+							if(!q || q == Tomb()) {
+								used += !q;
+								slot.store(p);
+								break;
+							}
+						}
+						++count;
+						return result;
+					}
+				//	Lookup() returns a reference to a live Node matching probe,
+				//	if there is one. It either needs a ReadGuard or the mutex,
+				//	and with kRevive (see Claim()), the mutex.
+				template<bool kRevive=false, typename Probe>
+					auto Lookup(std::size_t hash, const Probe& probe)
+						-> typename Ref::Result
+					{
+						if(auto pSlots = slots.load()) {
+							for(auto i = Mix(hash);; ++i) {
+								auto p = pSlots->at[i & pSlots->mask].load();
+								if(!p) {
+									break;
+								}
+								if(	p != Tomb() &&
+									HashMatches(p->entry, hash) &&
+									probe.Matches(p->entry.value))
+								{
+									if(auto result = Claim<kRevive,T,Policy>(
+										hash, p->entry
+										))
+									{
+										return result;
+									}
+								}
+							}
+						}
+						return {};
+					}
+
+				//	Prefetches the slot where a probe for hash would start.
+				//	The mutex must be held.
+				void Prefetch(std::size_t hash) const noexcept {
+					if(auto pSlots = slots.load(std::memory_order_relaxed)) {
+						details::Prefetch(
+							&pSlots->at[Mix(hash) & pSlots->mask]
+							);
+					}
+				}
+
+				//	Reserve() makes room for n live nodes without rebuilding
+				//	the array.
+				void Reserve(std::size_t n) {
+					std::lock_guard<TMutex<Policy>> lg{mutex};
+					ReserveLocked(n);
+				}
+
+				//	Census() reports the shard's size and (estimated) memory
+				//	footprint for Stats().
+				auto Census() -> ShardCensus {
+					std::lock_guard<TMutex<Policy>> lg{mutex};
+					ShardCensus census;
+					census.size = count;
+					if(auto pSlots = slots.load()) {
+						census.capacity = pSlots->mask + 1;
+					}
+					census.bytes = sizeof *this +
+						census.size * sizeof(Node) +
+						census.capacity * sizeof(std::atomic<Node*>);
+					CountWaits(mutex, census);
+					return census;
+				}
+
+				//	ForEach() calls f(entry) for every Entry in the shard,
+				//	including any waiting to be erased, under the mutex.
+				template<typename F>
+					void ForEach(F&& f) {
+						std::lock_guard<TMutex<Policy>> lg{mutex};
+						if(auto pSlots = slots.load()) {
+							for(std::size_t i = 0; i <= pSlots->mask; ++i) {
+								auto p = pSlots->at[i].load();
+								if(p && p != Tomb()) {
+									f(p->entry);
+								}
+							}
+						}
+					}
+
+				//	Purge() lets the Retention ring go before the table is
+				//	destroyed (see Table::Shards), and frees everything in
+				//	limbo without waiting for readers. Either may lead to
+				//	more of the same, so it returns whether there was any.
+				auto Purge() -> bool {
+					bool any = retention.Clear();
+					EraseGuard<T,Tuple,Policy,Ref> eg;
+					std::lock_guard<TMutex<Policy>> lg{mutex};
+					for(auto& lim: limbo) {
+						any |= !lim.nodes.empty();
+						Free(lim);
+					}
+					return any;
+				}
+
+				void Erase(std::size_t hash, const T* p) {
+					EraseGuard<T,Tuple,Policy,Ref> eg;
+					std::lock_guard<TMutex<Policy>> lg{mutex};
+					EraseLocked(hash, p);
+				}
+				template<typename It>
+					void EraseAll(It first, It last) {
+						EraseGuard<T,Tuple,Policy,Ref> eg;
+						std::lock_guard<TMutex<Policy>> lg{mutex};
+						for(; first != last; ++first) {
+							EraseLocked(first->first, first->second);
+						}
+					}
+
+			private:
+				void EraseLocked(std::size_t hash, const T* p) {
+					auto pSlots = slots.load();
+					for(auto i = Mix(hash);; ++i) {
+						auto& slot = pSlots->at[i & pSlots->mask];
+						if(auto q = slot.load();
+							q != Tomb() && &q->entry.value == p)
+						{
+							if(Spare(q->entry)) {
+								break;
+							}
+							Note<T,Policy,Ref>(Event::kErase, hash);
+							slot.store(Tomb());
+							--count;
+							Retire(q);
+							break;
+						}
+					}
+				}
+
+				//	Tombstones are marked by the address of a dummy Node-
+				//	aligned object, which is never dereferenced.
+				static auto Tomb() -> Node* {
+					alignas(Node) static char tomb;
+					return reinterpret_cast<Node*>(&tomb);
+				}
+
+				//	A ReadGuard must be held while looking at Nodes without
+				//	holding the mutex.
+				struct ReadGuard {
+					std::atomic<std::size_t>& readers;
+
+					explicit ReadGuard(LockFreeShard& shard):
+						readers{shard.readers[shard.epoch.load() & 1u]}
+					{
+						readers.fetch_add(1);
+					}
+					ReadGuard(const ReadGuard&) = delete;
+					auto operator = (const ReadGuard&) = delete;
+					~ReadGuard() {
+						readers.fetch_sub(1);
+					}
+				};
+
+				//	Makes sure there is room for n live nodes while keeping
+				//	the array (tombstones included) no more than kMaxLoad
+				//	percent full. A new array starts out half that full.
+				void ReserveLocked(std::size_t n) {
+					auto pSlots = slots.load();
+					auto capacity = pSlots ? pSlots->mask + 1 : 0;
+					if((used + n - count) * 100 <= capacity * kMaxLoad) {
+						return;
+					}
+					std::size_t newCapacity = kMinCapacity;
+					while(newCapacity * kMaxLoad < n * 200) {
+						newCapacity <<= 1;
+					}
+					auto pNew = new Slots(newCapacity);
+					if(pSlots) {
+						for(std::size_t i = 0; i <= pSlots->mask; ++i) {
+							auto p = pSlots->at[i].load();
+							if(!p || p == Tomb()) {
+								continue;
+							}
+							for(auto j = Mix(p->entry.Hash());; ++j) {
+								auto& slot = pNew->at[j & pNew->mask];
+								if(!slot.load(std::memory_order_relaxed)) {
+									slot.store(p, std::memory_order_relaxed);
+									break;
+								}
+							}
+						}
+					}
+					slots.store(pNew);
+					used = count;
+					if(pSlots) {
+						limbo[epoch.load() & 1u].slots.push_back(pSlots);
+						Reclaim(false);
+					}
+				}
+				void Retire(Node* p) {
+					limbo[epoch.load() & 1u].nodes.push_back(p);
+					Reclaim(true);
+				}
+
+				//	Reclaim() frees what was retired before the current epoch
+				//	once no reader can still see it. Freeing Nodes destroys
+				//	objects, which is only done when erasing (under an
+				//	EraseGuard). Otherwise, Nodes wait a while longer than they
+				//	need to, which is always safe.
+				void Reclaim(bool nodes) {
+					auto e = epoch.load();
+					if(readers[(e + 1u) & 1u].load() == 0) {
+						Free(limbo[(e + 1u) & 1u], nodes);
+						if(!limbo[e & 1u].nodes.empty() ||
+							!limbo[e & 1u].slots.empty())
+						{
+							epoch.store(e + 1u);
+						}
+					}
+				}
+				void Free(Limbo& lim, bool nodes=true) {
+					if(nodes) {
+						for(auto p: lim.nodes) {
+							DeleteNode(p);
+						}
+						lim.nodes.clear();
+					}
+					for(auto p: lim.slots) {
+						delete p;
+					}
+					lim.slots.clear();
+				}
+
+				using NodeAlloc =
+					Rebind<typename ShardMemory<Policy>::Allocator, Node>;
+				using NodeTraits = std::allocator_traits<NodeAlloc>;
+
+				template<typename... Args>
+					auto NewNode(Args&&... args) -> Node* {
+						NodeAlloc alloc{this->allocator};
+						auto p = NodeTraits::allocate(alloc, 1);
+						try {
+							return new(p) Node(std::forward<Args>(args)...);
+						}
+						catch(...) {
+							NodeTraits::deallocate(alloc, p, 1);
+							throw;
+						}
+					}
+				void DeleteNode(Node* p) {
+					NodeAlloc alloc{this->allocator};
+					p->~Node();
+					NodeTraits::deallocate(alloc, p, 1);
+				}
+			};
+
+		//	Slab hands out blocks of memory big enough for one Node at a time.
+		//	It carves them out of progressively larger chunks and recycles
+		//	freed ones through a free list, so that Nodes never move and
+		//	seldom hit the allocator (Alloc).
+		template<typename Node, typename Alloc>
+			struct Slab {
+				union Cell {
+					Cell* next;
+					alignas(Node) unsigned char bytes[sizeof(Node)];
+				};
+				using CellAlloc = Rebind<Alloc,Cell>;
+				using CellTraits = std::allocator_traits<CellAlloc>;
+
+				static constexpr std::size_t kMinChunk = 16;
+				static constexpr std::size_t kMaxChunk = 4096;
+
+				CellAlloc alloc;
+				std::vector<std::pair<Cell*,std::size_t>> chunks;
+				Cell* free = nullptr;
+				std::size_t chunkSize = kMinChunk;
+
+				explicit Slab(const Alloc& alloc): alloc{alloc} {}
+				Slab(const Slab&) = delete;
+				auto operator = (const Slab&) = delete;
+				~Slab() {
+					for(auto [chunk, size]: chunks) {
+						CellTraits::deallocate(alloc, chunk, size);
+					}
+				}
+
+				auto Allocate() -> void* {
+					if(!free) {
+						chunks.reserve(chunks.size() + 1);
+						auto chunk = CellTraits::allocate(alloc, chunkSize);
+						chunks.emplace_back(chunk, chunkSize);
+						for(std::size_t i = chunkSize; i-- > 0;) {
+							chunk[i].next = free;
+							free = &chunk[i];
+						}
+						chunkSize = std::min(2 * chunkSize, kMaxChunk);
+					}
+					auto p = free;
+					free = p->next;
+					return p;
+				}
+				void Free(void* p) {
+					auto cell = static_cast<Cell*>(p);
+					cell->next = free;
+					free = cell;
+				}
+			};
+
+		//	Group is a run of kWidth control bytes that can be scanned in one
+		//	go. Each control byte describes one slot in a FlatShard. A full
+		//	slot's byte holds the low 7 bits of its (mixed) hash, so the sign
+		//	bit is clear. Empty and deleted slots use negative markers. The
+		//	Match*() methods return a bit mask with bit i set if byte i
+		//	qualifies.
+		struct Group {
+			static constexpr std::size_t kWidth = 16;
+			static constexpr std::int8_t kEmpty = -128;
+			static constexpr std::int8_t kDeleted = -2;
+
+			struct alignas(kWidth) Bytes {
+				std::int8_t at[kWidth];
+			};
+
+		 #if INTERN_SSE2
+			__m128i ctrl;
+
+			explicit Group(const Bytes& bytes):
+				ctrl{_mm_load_si128(reinterpret_cast<const __m128i*>(&bytes))}
+				{}
+			auto Match(std::int8_t h2) const -> unsigned {
+				return static_cast<unsigned>(
+					_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_set1_epi8(h2), ctrl))
+					);
+			}
+			auto MatchFree() const -> unsigned {
+				return static_cast<unsigned>(_mm_movemask_epi8(ctrl));
+			}
+		 #else
+			const Bytes& ctrl;
+
+			explicit Group(const Bytes& bytes): ctrl{bytes} {}
+			auto Match(std::int8_t h2) const -> unsigned {
+				unsigned mask = 0;
+				for(std::size_t i = 0; i < kWidth; ++i) {
+					mask |= unsigned{ctrl.at[i] == h2} << i;
+				}
+				return mask;
+			}
+			auto MatchFree() const -> unsigned {
+				unsigned mask = 0;
+				for(std::size_t i = 0; i < kWidth; ++i) {
+					mask |= unsigned{ctrl.at[i] < 0} << i;
+				}
+				return mask;
+			}
+		 #endif
+			auto MatchEmpty() const -> unsigned {
+				return Match(kEmpty);
+			}
+
+			//	Returns the index of the lowest set bit in a non-zero mask.
+			static auto First(unsigned mask) -> std::size_t {
+			 #if defined(__GNUC__)
+				return static_cast<std::size_t>(__builtin_ctz(mask));
+			 #else
+				std::size_t i = 0;
+				for(; !(mask & 1u); mask >>= 1) {
+					++i;
+				}
+				return i;
+			 #endif
+			}
+		};
+
+		//	FlatShard is a Swiss table of Node pointers guarded by a mutex,
+		//	with the Nodes themselves living in a Slab.
+		//
+		//	The slots are divided into groups of Group::kWidth, each with a
+		//	parallel array of control bytes. An object's mixed hash is split
+		//	in two. The high bits (H1) pick the group where probing starts, and
+		//	the low 7 bits (H2) are what go into the control byte. A look-up
+		//	loads a whole group of control bytes and only follows the slots
+		//	whose H2 matches, which usually means touching a single Node. If
+		//	a group has any empty slots, the probe stops there. Otherwise, it
+		//	moves on to other groups in triangular (quadratic) order.
+		//
+		//	Erasing a slot in a group that has no empty slots must leave a
+		//	deleted marker (tombstone) so that probes continue past it. These
+		//	are cleaned up the next time the table is rehashed.
+		//
+		//	Rehashing moves everything into fresh arrays. With
+		//	policy::IncrementalRehash, the old ones are kept on the side (see
+		//	Old) rather than emptied on the spot. Every entry lives in either
+		//	the old arrays or the new ones, and look-ups and erasures check
+		//	both. The room the old entries will need is set aside in
+		//	growthLeft from the start, so that the new arrays cannot fill up
+		//	before they have all moved over.
+		template<typename T, typename Tuple, typename Policy, typename Ref>
+			struct alignas(kCacheLine) FlatShard: ShardMemory<Policy> {
+				using Node = details::Node<T,Ref>;
+
+				static constexpr std::size_t kMinCapacity = 2 * Group::kWidth;
+
+				using ShardMemory<Policy>::ShardMemory;
+
+				//	Old holds the arrays being moved out of, and the index of
+				//	the next slot to move.
+				struct Old {
+					std::unique_ptr<Group::Bytes[]> ctrl;
+					std::unique_ptr<Node*[]> slots;
+					std::size_t capacity = 0;
+					std::size_t next = 0;
+				};
+
+				TMutex<Policy> mutex;
+				std::unique_ptr<Group::Bytes[]> ctrl;
+				std::unique_ptr<Node*[]> slots;
+				std::size_t capacity = 0;
+				std::size_t count = 0;  // live nodes, including any in old
+				std::size_t growthLeft = 0;  // until MaxFill(), tombstones too
+				Old old;
+				Slab<Node, typename ShardMemory<Policy>::Allocator> slab{
+					this->allocator
+					};
+				Retention<Ref,Ref::kCounted ? Policy::kRetain : 0> retention;
+
+				FlatShard() = default;
+				FlatShard(const FlatShard&) = delete;
+				auto operator = (const FlatShard&) = delete;
+				~FlatShard() {
+					retention.Clear();
+					for(std::size_t i = 0; i < capacity; ++i) {
+						if(Ctrl(i) >= 0) {
+							slots[i]->~Node();
+						}
+					}
+					for(auto i = old.next; i < old.capacity; ++i) {
+						if(CtrlIn(old.ctrl.get(), i) >= 0) {
+							old.slots[i]->~Node();
+						}
+					}
+				}
+
+				template<typename Probe>
+					auto Intern(std::size_t hash, Probe& probe)
+						-> typename Ref::Result
+					{
+						std::lock_guard<TMutex<Policy>> lg{mutex};
+						return InternLocked(hash, probe);
+					}
+
+				//	TryIntern() is Intern() except that, rather than wait for
+				//	the mutex, it returns a null Result.
+				template<typename Probe>
+					auto TryIntern(std::size_t hash, Probe& probe)
+						-> typename Ref::Result
+					{
+						std::unique_lock<TMutex<Policy>> lk{
+							mutex, std::try_to_lock
+							};
+						if(!lk) {
+							return {};
+						}
+						return InternLocked(hash, probe);
+					}
+
+				//	InternLocked() is Intern() for callers already holding the
+				//	mutex, such as batch interning.
+				template<typename Probe>
+					auto InternLocked(std::size_t hash, Probe& probe)
+						-> typename Ref::Result
+					{
+						if(auto result = Lookup<true>(hash, probe)) {
+							return result;
+						}
+						Note<T,Policy,Ref>(Event::kIntern, hash);
+						auto i = PrepareInsert(hash);
+						auto mem = slab.Allocate();
+						Node* p;
+						try {
+							p = std::apply(
+								[mem, hash](auto&&... args) {
+									return new(mem) Node(
+										hash,
+										std::forward<decltype(args)>(args)...
+										);
+								},
+								probe.EntryArgs()
+								);
+						}
+						catch(...) {
+							slab.Free(mem);
+							throw;
+						}
+						growthLeft -= Ctrl(i) == Group::kEmpty;
+						SetCtrl(i, H2(Mix(hash)));
+						slots[i] = p;
+						++count;
+						return Ref::Adopt(p->entry);
+					}
+				//	Lookup() returns a reference to a live Node matching probe,
+				//	if there is one. With kRevive, a Node waiting to be erased
+				//	counts as live (see Claim()). The mutex must be held.
+				template<bool kRevive=false, typename Probe>
+					auto Lookup(std::size_t hash, const Probe& probe) const
+						-> typename Ref::Result
+					{
+						auto result = LookupIn<kRevive>(
+							ctrl.get(), slots.get(), capacity, hash, probe
+							);
+						if(!result && old.capacity) {
+							result = LookupIn<kRevive>(
+								old.ctrl.get(), old.slots.get(), old.capacity,
+								hash, probe
+								);
+						}
+						return result;
+					}
+
+				//	Prefetches the control bytes and slots of the group where
+				//	a probe for hash would start. The mutex must be held.
+				void Prefetch(std::size_t hash) const noexcept {
+					if(capacity) {
+						auto g = H1(Mix(hash)) & (capacity / Group::kWidth - 1);
+						details::Prefetch(&ctrl[g]);
+						details::Prefetch(&slots[g * Group::kWidth]);
+					}
+				}
+
+				//	Census() reports the shard's size and (estimated) memory
+				//	footprint for Stats().
+				auto Census() -> ShardCensus {
+					std::lock_guard<TMutex<Policy>> lg{mutex};
+					ShardCensus census;
+					census.size = count;
+					census.capacity = capacity + old.capacity;
+
+					//	Each slot has a control byte and a Node pointer.
+					census.bytes = sizeof *this +
+						census.size * sizeof(Node) +
+						census.capacity * (1 + sizeof(Node*));
+					CountWaits(mutex, census);
+					return census;
+				}
+
+				//	Reserve() makes room for n live nodes, rehashing now (all
+				//	at once) if need be so as not to later.
+				void Reserve(std::size_t n) {
+					std::lock_guard<TMutex<Policy>> lg{mutex};
+					if(MaxFill(capacity) >= n) {
+						return;
+					}
+					auto newCapacity = std::max(capacity, kMinCapacity);
+					while(MaxFill(newCapacity) < n) {
+						newCapacity <<= 1;
+					}
+					Rehash(newCapacity);
+					Migrate(old.capacity);
+				}
+
+				//	ForEach() calls f(entry) for every Entry in the shard,
+				//	including any waiting to be erased, under the mutex.
+				template<typename F>
+					void ForEach(F&& f) {
+						std::lock_guard<TMutex<Policy>> lg{mutex};
+						for(std::size_t i = 0; i < capacity; ++i) {
+							if(Ctrl(i) >= 0) {
+								f(slots[i]->entry);
+							}
+						}
+						for(auto i = old.next; i < old.capacity; ++i) {
+							if(CtrlIn(old.ctrl.get(), i) >= 0) {
+								f(old.slots[i]->entry);
+							}
+						}
+					}
+
+				//	Purge() lets the Retention ring go before the table is
+				//	destroyed (see Table::Shards). Since erasing what was in
+				//	it may fill another shard's ring, it returns whether there
+				//	was anything.
+				auto Purge() -> bool {
+					return retention.Clear();
+				}
+
+				void Erase(std::size_t hash, const T* p) {
+					EraseGuard<T,Tuple,Policy,Ref> eg;
+					std::lock_guard<TMutex<Policy>> lg{mutex};
+					EraseLocked(hash, p);
+				}
+				template<typename It>
+					void EraseAll(It first, It last) {
+						EraseGuard<T,Tuple,Policy,Ref> eg;
+						std::lock_guard<TMutex<Policy>> lg{mutex};
+						for(; first != last; ++first) {
+							EraseLocked(first->first, first->second);
+						}
+					}
+
+			private:
+				//	The most slots (live or tombstoned) that may be in use
+				//	before the table must grow.
+				static constexpr auto MaxFill(std::size_t capacity)
+					-> std::size_t
+				{
+					if constexpr(Policy::kMaxLoad != 0) {
+						return capacity * Policy::kMaxLoad / 100u;
+					}
+					else {
+						return capacity - capacity / 8u;
+					}
+				}
+
+				template<bool kRevive, typename Probe>
+					static auto LookupIn(
+						const Group::Bytes* ctrls, Node* const* nodes,
+						std::size_t cap, std::size_t hash, const Probe& probe
+						) -> typename Ref::Result
+					{
+						if(!cap) {
+							return {};
+						}
+						auto mixed = Mix(hash);
+						auto mask = cap / Group::kWidth - 1;
+						auto g = H1(mixed) & mask;
+						for(std::size_t step = 1;; g = (g + step++) & mask) {
+							Group grp{ctrls[g]};
+							for(auto bits = grp.Match(H2(mixed)); bits;
+								bits &= bits - 1)
+							{
+								auto i = g * Group::kWidth + Group::First(bits);
+								auto q = nodes[i];
+								if(	HashMatches(q->entry, hash) &&
+									probe.Matches(q->entry.value))
+								{
+									if(auto result = Claim<kRevive,T,Policy>(
+										hash, q->entry
+										))
+									{
+										return result;
+									}
+								}
+							}
+							if(grp.MatchEmpty()) {
+								return {};
+							}
+						}
+					}
+
+				void EraseLocked(std::size_t hash, const T* p) {
+					auto ctrls = ctrl.get();
+					auto nodes = slots.get();
+					auto i = FindIn(ctrls, nodes, capacity, hash, p);
+					bool inOld = i == capacity;
+					if(inOld) {
+						ctrls = old.ctrl.get();
+						nodes = old.slots.get();
+						i = FindIn(ctrls, nodes, old.capacity, hash, p);
+					}
+					auto q = nodes[i];
+					if(Spare(q->entry)) {
+						return;
+					}
+					Note<T,Policy,Ref>(Event::kErase, hash);
+					auto& bytes = ctrls[i / Group::kWidth];
+					bool wasFull = !Group{bytes}.MatchEmpty();
+					bytes.at[i % Group::kWidth] =
+						wasFull ? Group::kDeleted : Group::kEmpty;
+
+					//	An entry erased from the old arrays gives back the room
+					//	set aside for it in the new ones.
+					growthLeft += inOld || !wasFull;
+					--count;
+					q->~Node();
+					slab.Free(q);
+				}
+
+				//	FindIn() returns the index of the slot holding p in the
+				//	given arrays, or cap if it is not there.
+				static auto FindIn(
+					const Group::Bytes* ctrls, Node* const* nodes,
+					std::size_t cap, std::size_t hash, const T* p
+					) -> std::size_t
+				{
+					if(!cap) {
+						return cap;
+					}
+					auto mixed = Mix(hash);
+					auto mask = cap / Group::kWidth - 1;
+					auto g = H1(mixed) & mask;
+					for(std::size_t step = 1;; g = (g + step++) & mask) {
+						Group grp{ctrls[g]};
+						for(auto bits = grp.Match(H2(mixed)); bits;
+							bits &= bits - 1)
+						{
+							auto i = g * Group::kWidth + Group::First(bits);
+							if(&nodes[i]->entry.value == p) {
+								return i;
+							}
+						}
+						if(grp.MatchEmpty()) {
+							return cap;
+						}
+					}
+				}
+
+				//	The hash is mixed (see Mix()) before it is split into H1 and
+				//	H2.
+				static auto H1(std::size_t mixed) -> std::size_t {
+					return mixed >> 7;
+				}
+				static auto H2(std::size_t mixed) -> std::int8_t {
+					return static_cast<std::int8_t>(mixed & 0x7f);
+				}
+
+				static auto CtrlIn(const Group::Bytes* ctrls, std::size_t i)
+					-> std::int8_t
+				{
+					return ctrls[i / Group::kWidth].at[i % Group::kWidth];
+				}
+				auto Ctrl(std::size_t i) const -> std::int8_t {
+					return CtrlIn(ctrl.get(), i);
+				}
+				void SetCtrl(std::size_t i, std::int8_t c) {
+					ctrl[i / Group::kWidth].at[i % Group::kWidth] = c;
+				}
+
+				//	Returns the first empty or deleted slot in hash's probe
+				//	sequence, growing or cleaning up the table first if it is
+				//	out of room. (With policy::IncrementalRehash, this is also
+				//	where the next few old slots are moved.)
+				auto PrepareInsert(std::size_t hash) -> std::size_t {
+					if constexpr(Policy::kRehashStep != 0) {
+						if(old.capacity) {
+							Migrate(Policy::kRehashStep);
+						}
+					}
+					while(!growthLeft) {
+						Rehash(
+							count < MaxFill(capacity) / 2 ? capacity :
+							std::max(2 * capacity, kMinCapacity)
+							);
+					}
+					return FindFree(hash);
+				}
+				auto FindFree(std::size_t hash) const -> std::size_t {
+					auto mask = capacity / Group::kWidth - 1;
+					auto g = H1(Mix(hash)) & mask;
+					for(std::size_t step = 1;; g = (g + step++) & mask) {
+						if(auto bits = Group{ctrl[g]}.MatchFree()) {
+							return g * Group::kWidth + Group::First(bits);
+						}
+					}
+				}
+				//	Rehash() swaps in fresh arrays of newCapacity slots, first
+				//	finishing any move still in progress. The current arrays
+				//	become the old ones, which are emptied right away unless
+				//	policy::IncrementalRehash says to do it bit by bit.
+				void Rehash(std::size_t newCapacity) {
+					Migrate(old.capacity);
+					old.ctrl = std::move(ctrl);
+					old.slots = std::move(slots);
+					old.capacity = capacity;
+					old.next = 0;
+					ctrl.reset(new Group::Bytes[newCapacity / Group::kWidth]);
+					slots.reset(new Node*[newCapacity]);
+					capacity = newCapacity;
+					for(std::size_t i = 0; i < capacity; ++i) {
+						SetCtrl(i, Group::kEmpty);
+					}
+					growthLeft = MaxFill(capacity) - count;
+					if constexpr(Policy::kRehashStep == 0) {
+						Migrate(old.capacity);
+					}
+				}
+
+				//	Migrate() moves up to n more of the old slots' Nodes into
+				//	the current arrays, and frees the old arrays once done.
+				void Migrate(std::size_t n) {
+					auto end = std::min(old.next + n, old.capacity);
+					for(; old.next < end; ++old.next) {
+						auto i = old.next;
+						if(auto c = CtrlIn(old.ctrl.get(), i); c >= 0) {
+							auto q = old.slots[i];
+							auto j = FindFree(q->entry.Hash());
+
+							//	(Its room was set aside assuming it would take
+							//	an empty slot rather than a tombstone.)
+							growthLeft += Ctrl(j) != Group::kEmpty;
+							SetCtrl(j, c);
+							slots[j] = q;
+
+							//	Look-ups still go through the old slots until
+							//	they are freed, so the moved Node must not be
+							//	found there too: once erased from the new ones,
+							//	it is gone. A tombstone keeps the old probe
+							//	sequences intact.
+							old.ctrl[i / Group::kWidth].at[i % Group::kWidth] =
+								Group::kDeleted;
+						}
+					}
+					if(old.next == old.capacity) {
+						old = Old{};
+					}
+				}
+			};
+
+		//	Table holds the global shard(s) for a given T/Tuple/Policy. With
+		//	the default policy, there is a single shard. Otherwise, ShardFor()
+		//	scrambles an object's hash and uses the top bits to pick a shard.
+		//	(The low bits are left to the shard itself, which uses them to
+		//	pick a bucket or slot.)
+		template<
+			typename T, typename Tuple, typename Policy,
+			typename Ref=SharedRef<T,Tuple,Policy>
+			>
+			struct Table {
+				static constexpr std::size_t kShards = Policy::kShards;
+
+				using Backend = policy::Backend;
+				using Shard = std::conditional_t<
+					Policy::kBackend == Backend::kLockFree,
+					LockFreeShard<T,Tuple,Policy,Ref>,
+					std::conditional_t<
+						Policy::kBackend == Backend::kFlat,
+						FlatShard<T,Tuple,Policy,Ref>,
+						MapShard<T,Tuple,Policy,Ref>
+						>
+					>;
+
+				//	Shards is the type of gShards. Before any shard is
+				//	destroyed, each one gives up what it is still holding on to
+				//	for entries that have died (see Purge()), since erasing
+				//	those may release entries in the others.
+				struct Shards: std::array<Shard,kShards> {
+					~Shards() {
+						for(bool more = true; more;) {
+							more = false;
+							for(auto& shard: *this) {
+								more |= shard.Purge();
+							}
+						}
+					}
+				};
+				static inline Shards gShards;
+
+				static auto ShardIndex(std::size_t hash) -> std::size_t {
+					return Spread<kShards>(hash);
+				}
+				static auto ShardFor(std::size_t hash) -> Shard& {
+					return gShards[ShardIndex(hash)];
+				}
+
+				//	Release() is called once the last reference to an entry is
+				//	gone. With policy::Retain, it revives the entry and gives
+				//	the new reference to its shard's Retention ring. This is
+				//	done under the shard's mutex, and only if a look-up has not
+				//	revived the entry already (see Claim()) and no replacement
+				//	has been inserted since the entry died, so that there are
+				//	never two live entries for the same value. Otherwise, and
+				//	once the ring evicts it, the entry is erased. (All this
+				//	happens in ReleaseNow(), which Release() leaves to the
+				//	thread's EraseGuard, if it holds one.)
+				static void Release(typename Ref::TEntry& entry) {
+					using TGuard = EraseGuard<T,Tuple,Policy,Ref>;
+					bool evicting = false;
+					if constexpr(Policy::kRetain != 0) {
+						evicting = std::exchange(
+							Retention<Ref,Policy::kRetain>::tEvicting, false
+							);
+					}
+					if(!TGuard::Defer(entry, evicting, &ReleaseNow)) {
+						ReleaseNow(entry, evicting);
+					}
+				}
+				static void ReleaseNow(
+					typename Ref::TEntry& entry, bool evicting
+					)
+				{
+					//	Reviving an entry under SharedRef means storing a new
+					//	weak pointer in it, which lock-free readers might be
+					//	reading at the same time.
+					static_assert(
+						Policy::kRetain == 0 ||
+						Policy::kBackend != policy::Backend::kLockFree ||
+						!std::is_same_v<Ref, SharedRef<T,Tuple,Policy>>,
+						"policy::Retain requires MakeHandle() with LockFreeReads"
+						);
+					auto hash = entry.Hash();
+					if constexpr(Policy::kRetain != 0) {
+						using TRetention = Retention<Ref,Policy::kRetain>;
+						if(evicting) {
+							ShardFor(hash).Erase(hash, &entry.value);
+							return;
+						}
+						auto& shard = ShardFor(hash);
+						typename Ref::Result live, victim;
+						{
+							std::lock_guard<TMutex<Policy>> lg{shard.mutex};
+							if(Spare(entry)) {
+								return;
+							}
+							Probe<T,Tuple,Policy,const T&> probe{
+								entry.value, {}
+								};
+							live = shard.Lookup(hash, probe);
+							if(!live) {
+								victim = shard.retention.Push(
+									Ref::Adopt(entry)
+									);
+							}
+						}
+						if(live) {
+							Erase(hash, &entry.value);
+						}
+						TRetention::Evict(std::move(victim));
+					}
+					else {
+						static_cast<void>(evicting);
+						Erase(hash, &entry.value);
+					}
+				}
+
+				//	Erase() removes the entry whose value p points to once its
+				//	last reference is gone. With policy::DeferredErase, this
+				//	only adds it to the calling thread's RetireList.
+				static void Erase(std::size_t hash, const T* p) {
+					if constexpr(Policy::kEraseBatch == 0) {
+						ShardFor(hash).Erase(hash, p);
+					}
+					else {
+						RetireList::Local().Push(hash, p);
+					}
+				}
+				static void Collect() {
+					if constexpr(Policy::kThreadCache != 0 && Ref::kCounted) {
+						FrontCache::Local().Clear();
+					}
+					if constexpr(Policy::kEraseBatch != 0) {
+						RetireList::Local().Flush();
+					}
+				}
+
+				//	AddStats() adds this table's counts and shard censuses to
+				//	stats, whose shardSizes must have kShards elements.
+				static void AddStats(TableStats& stats) {
+					if constexpr(Policy::kStats) {
+						auto counts = StatsBook<Policy,Ref>::Sum();
+						stats.interns += counts[0];
+						stats.fetches += counts[1];
+						stats.erases += counts[2];
+					}
+					for(std::size_t i = 0; i < kShards; ++i) {
+						auto census = gShards[i].Census();
+						stats.live += census.size;
+						stats.capacity += census.capacity;
+						stats.bytes += census.bytes;
+						stats.lockWaits += census.lockWaits;
+						stats.lockWaitTime +=
+							std::chrono::nanoseconds{census.lockWaitNs};
+						stats.shardSizes[i] += census.size;
+					}
+				}
+
+				//	Reserve() makes room for n entries across the shards. Since
+				//	hashes never spread out perfectly evenly, each shard gets
+				//	an extra 1/8 of its share.
+				static void Reserve(std::size_t n) {
+					auto share = (n + kShards - 1) / kShards;
+					if constexpr(kShards > 1) {
+						share += share / 8u;
+					}
+					for(auto& shard: gShards) {
+						shard.Reserve(share);
+					}
+				}
+
+				//	Intern() looks in the calling thread's FrontCache (with
+				//	policy::ThreadCache) before going to hash's shard. The
+				//	slot is refilled with whatever the shard returns. With
+				//	kTry, the shard's TryIntern() is called instead, and a
+				//	null Result leaves the slot alone.
+				template<bool kTry=false, typename Probe>
+					static auto Intern(std::size_t hash, Probe& probe)
+						-> typename Ref::Result
+					{
+						auto intern = [hash, &probe] {
+							if constexpr(kTry) {
+								return ShardFor(hash).TryIntern(hash, probe);
+							}
+							else {
+								return ShardFor(hash).Intern(hash, probe);
+							}
+						};
+
+						//	(Caching an uncounted Id would not keep its object
+						//	from being unpinned, so only counted refs qualify.)
+						if constexpr(
+							Policy::kThreadCache == 0 || !Ref::kCounted
+							)
+						{
+							return intern();
+						}
+						else {
+							auto& slot = FrontCache::Local().slots[
+								Spread<Policy::kThreadCache>(hash)
+								];
+							if(	slot.ref && slot.hash == hash &&
+								probe.Matches(*slot.ref))
+							{
+								Note<T,Policy,Ref>(Event::kFetch, hash);
+								return slot.ref;
+							}
+							auto result = intern();
+							if(!kTry || result) {
+								slot.hash = hash;
+								slot.ref = result;
+							}
+							return result;
+						}
+					}
+
+				//	InternBatch() interns each element of [first, last) as if
+				//	by Intern(), and writes the results to out in order. The
+				//	probes are all built and hashed up front and then grouped
+				//	by shard (see Group()), so that each shard's mutex is taken
+				//	only once (see InternGroup()).
+				template<typename It, typename Out>
+					static auto InternBatch(It first, It last, Out out) -> Out {
+						using TProbe =
+							decltype(MakeProbe<T,Tuple,Policy>(*first));
+
+						auto n = static_cast<std::size_t>(
+							std::distance(first, last)
+							);
+						std::vector<TProbe> probes;
+						probes.reserve(n);
+						std::vector<Item> items(n);
+						for(std::size_t i = 0; i < n; ++i, ++first) {
+							probes.push_back(MakeProbe<T,Tuple,Policy>(*first));
+							items[i] = Item{probes.back().Hash(), i};
+						}
+
+						//	The results only go to out once the shards are
+						//	unlocked. Writing to out may drop the last reference
+						//	to an object in this very table, whose erasure would
+						//	then relock its shard.
+						std::vector<typename Ref::Result> results(n);
+						auto store = [&results](std::size_t k, auto&& r) {
+							results[k] = std::move(r);
+						};
+
+						//	With only one shard, there is nothing to reorder.
+						if constexpr(kShards == 1) {
+							InternGroup(
+								gShards[0], items.data(), items.data() + n,
+								probes, store
+								);
+						}
+						else {
+							auto [grouped, starts] = Group(items);
+							for(std::size_t i = 0; i < kShards; ++i) {
+								InternGroup(
+									gShards[i],
+									grouped.data() + starts[i],
+									grouped.data() + starts[i + 1],
+									probes, store
+									);
+							}
+						}
+						return std::move(results.begin(), results.end(), out);
+					}
+
+				//	InternParallel() does the work of InternBatch() in tasks
+				//	run by executor (see MakeInternedParallel()). First, each
+				//	of up to tasks tasks builds and hashes the probes for one
+				//	slice of the range. Then, once they are grouped by shard,
+				//	each of g = min(slices, kShards) tasks interns the groups
+				//	for every g-th shard, so that no two of them ever want the
+				//	same mutex. If any task throws, the first exception is
+				//	rethrown once they are all done.
+				template<typename It, typename Out, typename Executor>
+					static auto InternParallel(
+						It first, It last, Out out,
+						std::size_t tasks, Executor&& executor
+						) -> Out
+					{
+						using TProbe =
+							decltype(MakeProbe<T,Tuple,Policy>(*first));
+
+						auto n = static_cast<std::size_t>(
+							std::distance(first, last)
+							);
+						if(n == 0) {
+							return out;
+						}
+						std::mutex errorMutex;
+						std::exception_ptr error;
+						auto run = [&](std::size_t count, auto&& body) {
+							auto task = [&](std::size_t i) {
+								try {
+									body(i);
+								}
+								catch(...) {
+									std::lock_guard<std::mutex> lg{errorMutex};
+									if(!error) {
+										error = std::current_exception();
+									}
+								}
+							};
+							executor(count, task);
+							if(error) {
+								std::rethrow_exception(error);
+							}
+						};
+
+						//	A slice's probes go into place as they are built.
+						//	(Probes are not assignable, hence the optionals.)
+						std::vector<std::optional<TProbe>> probes(n);
+						std::vector<Item> items(n);
+						auto slices = std::clamp<std::size_t>(tasks, 1, n);
+						std::vector<It> starts(slices);
+						for(std::size_t s = 0, i = 0; s < slices; ++s) {
+							auto begin = n * s / slices;
+							std::advance(first, begin - i);
+							i = begin;
+							starts[s] = first;
+						}
+						run(slices, [&](std::size_t s) {
+							auto it = starts[s];
+							auto end = n * (s + 1) / slices;
+							for(auto i = n * s / slices; i < end; ++i, ++it) {
+								probes[i].emplace(
+									MakeProbe<T,Tuple,Policy>(*it)
+									);
+								items[i] = Item{probes[i]->Hash(), i};
+							}
+						});
+
+						//	(Structured bindings cannot be captured in C++17.)
+						std::vector<Item> grouped;
+						std::array<std::size_t,kShards + 1> groupStarts;
+						std::tie(grouped, groupStarts) = Group(items);
+						std::vector<typename Ref::Result> results(n);
+						auto groups = std::min<std::size_t>(slices, kShards);
+						run(groups, [&](std::size_t g) {
+							for(auto i = g; i < kShards; i += groups) {
+								InternGroup(
+									gShards[i],
+									grouped.data() + groupStarts[i],
+									grouped.data() + groupStarts[i + 1],
+									probes,
+									[&results](std::size_t k, auto&& r) {
+										results[k] = std::move(r);
+									});
+							}
+						});
+						return std::move(results.begin(), results.end(), out);
+					}
+
+			private:
+				struct Item {
+					std::size_t hash;
+					std::size_t index;
+				};
+
+				static constexpr auto Log2(std::size_t n) -> int {
+					return n > 1 ? 1 + Log2(n >> 1) : 0;
+				}
+
+				//	InternGroup() interns the probes for [begin, end), which
+				//	all belong to shard, under a single lock. While one is
+				//	being interned, the shard's memory for one a few places
+				//	further along is prefetched. Each result goes to
+				//	emit(index, result), which is called under the lock and
+				//	so must not release any reference into this table.
+				template<typename Probes, typename Emit>
+					static void InternGroup(
+						Shard& shard, const Item* begin, const Item* end,
+						Probes& probes, Emit&& emit
+						)
+					{
+						constexpr std::ptrdiff_t kAhead = 4;
+						if(begin == end) {
+							return;
+						}
+						std::lock_guard<TMutex<Policy>> lg{shard.mutex};
+						for(auto p = begin; p < end && p < begin + kAhead; ++p) {
+							shard.Prefetch(p->hash);
+						}
+						for(auto p = begin; p < end; ++p) {
+							if(end - p > kAhead) {
+								shard.Prefetch(p[kAhead].hash);
+							}
+							emit(p->index, shard.InternLocked(
+								p->hash, Deref(probes[p->index])
+								));
+						}
+					}
+				template<typename Probe>
+					static auto Deref(Probe& probe) -> Probe& {
+						return probe;
+					}
+				template<typename Probe>
+					static auto Deref(std::optional<Probe>& probe) -> Probe& {
+						return *probe;
+					}
+
+				//	Group() sorts items by shard (with a counting sort) and
+				//	returns the grouped items along with where each shard's
+				//	group starts.
+				static auto Group(const std::vector<Item>& items)
+					-> std::pair<
+						std::vector<Item>, std::array<std::size_t,kShards + 1>
+						>
+				{
+					std::array<std::size_t,kShards + 1> starts{};
+					for(auto& item: items) {
+						++starts[ShardIndex(item.hash) + 1];
+					}
+					for(std::size_t i = 0; i < kShards; ++i) {
+						starts[i + 1] += starts[i];
+					}
+					std::vector<Item> grouped(items.size());
+					auto ends = starts;
+					for(auto& item: items) {
+						grouped[ends[ShardIndex(item.hash)]++] = item;
+					}
+					return {std::move(grouped), starts};
+				}
+
+				//	Spread<N>() maps a hash value to an index below N (a power
+				//	of 2) by taking the top bits of a Fibonacci hash.
+				template<std::size_t N>
+					static auto Spread(std::size_t hash) -> std::size_t {
+						if constexpr(N == 1) {
+							return 0;
+						}
+						else {
+							constexpr std::size_t kMagic =
+								sizeof(std::size_t) * CHAR_BIT > 32u ?
+								0x9e3779b97f4a7c15 : 0x9e3779b9;
+							constexpr int kShift =
+								sizeof(std::size_t) * CHAR_BIT - Log2(N);
+							return (hash * kMagic) >> kShift;
+						}
+					}
+
+				//	A FrontCache is one thread's policy::ThreadCache: an array
+				//	of slots indexed by Spread() hash values, each holding the
+				//	hash and a strong reference to the object. Holding strong
+				//	references means that an entry can never be erased out
+				//	from under a slot, so there is nothing to invalidate. (The
+				//	RetireList, if any, is constructed first so that it is
+				//	still around when the cache is destroyed at thread exit.)
+				struct FrontCache {
+					struct Slot {
+						std::size_t hash = 0;
+						typename Ref::Result ref;
+					};
+
+					std::array<Slot,Policy::kThreadCache> slots;
+
+					FrontCache() {
+						if constexpr(Policy::kEraseBatch != 0) {
+							RetireList::Local();
+						}
+					}
+					FrontCache(const FrontCache&) = delete;
+					auto operator = (const FrontCache&) = delete;
+
+					static auto Local() -> FrontCache& {
+						thread_local FrontCache cache;
+						return cache;
+					}
+					void Clear() {
+						for(auto& slot: slots) {
+							slot.ref = {};
+						}
+					}
+				};
+
+				//	A RetireList collects dead entries per shard until there
+				//	are kEraseBatch of them, at which point each shard's batch
+				//	is erased under a single lock. Each thread has its own
+				//	list, which is also flushed when the thread exits.
+				//
+				//	Erasing entries destroys objects which may in turn release
+				//	others. While a Flush() is under way, those only join the
+				//	batches, and the Flush() keeps going until every batch is
+				//	empty.
+				struct RetireList {
+					using Batch = std::vector<std::pair<std::size_t,const T*>>;
+
+					std::array<Batch,kShards> batches;
+					std::size_t size = 0;
+					bool flushing = false;
+
+					RetireList() = default;
+					RetireList(const RetireList&) = delete;
+					auto operator = (const RetireList&) = delete;
+					~RetireList() {
+						Flush();
+					}
+
+					static auto Local() -> RetireList& {
+						thread_local RetireList list;
+						return list;
+					}
+					void Push(std::size_t hash, const T* p) {
+						batches[ShardIndex(hash)].emplace_back(hash, p);
+						if(++size >= Policy::kEraseBatch && !flushing) {
+							Flush();
+						}
+					}
+					void Flush() {
+						if(flushing) {
+							return;
+						}
+						flushing = true;
+						try {
+							for(bool more = true; more;) {
+								more = false;
+								size = 0;
+								for(std::size_t i = 0; i < kShards; ++i) {
+									if(batches[i].empty()) {
+										continue;
+									}
+									more = true;
+
+									//	The batch is moved out of the way
+									//	first, so that EraseAll() has it all
+									//	to itself.
+									auto batch = std::move(batches[i]);
+									batches[i].clear();
+									gShards[i].EraseAll(
+										batch.begin(), batch.end()
+										);
+									if(batches[i].empty()) {
+										batch.clear();
+										batches[i].swap(batch);
+									}
+								}
+							}
+						}
+						catch(...) {
+							flushing = false;
+							throw;
+						}
+						flushing = false;
+					}
+				};
+			};
+
+		//	Unlike a traditional shared_ptr, those returned by MakeInterned() do
+		//	not allocate memory directly. Rather, they let global maps do so
+		//	through Entry allocation. Deleter serves as a functor that is
+		//	passed to the shared_ptr to handle deallocation which, in this case,
+		//	means erasing the relevant entry from its Table.
+		template<typename T, typename Tuple, typename Policy>
+			struct Deleter {
+				using TTable = Table<T,Tuple,Policy>;
+
+				Entry<T,SharedRef<T,Tuple,Policy>>* entry;
+
+				void operator()(const T*) const {
+					TTable::Release(*entry);
+				}
+			};
+
+		template<typename T, typename Tuple, typename Policy>
+			void HandleRef<T,Tuple,Policy>::Release(TEntry& entry) {
+				Table<T,Tuple,Policy,HandleRef>::Release(entry);
+			}
+
+		//	InternView() backs the public InternView() and InternHandleView().
+		//	Its Probe compares stored objects against view itself, and builds
+		//	a T from args (or failing that, view) only on a miss.
+		template<
+			typename T, typename Tuple, typename Policy, typename Ref,
+			typename View, typename... Args
+			>
+			auto InternView(std::size_t hash, const View& view, Args&&... args)
+				-> typename Ref::Result
+			{
+				using TTable = Table<T,Tuple,Policy,Ref>;
+				if constexpr(sizeof...(Args) == 0) {
+					Probe<T,Tuple,Policy,const View&,const View&> probe{
+						view, {view}
+						};
+					return TTable::Intern(hash, probe);
+				}
+				else {
+					Probe<T,Tuple,Policy,const View&,Args...> probe{
+						view, {std::forward<Args>(args)...}
+						};
+					return TTable::Intern(hash, probe);
+				}
+			}
+
+		//	Unpin() frees the slot, which also zeroes the entry's index so
+		//	that look-ups skip it from then on. Only the caller that finds the
+		//	slot occupied goes on to erase the entry.
+		template<typename T, typename Tuple, typename Policy>
+			void IdRef<T,Tuple,Policy>::Unpin(Result id) {
+				if(auto p = gSlots.Remove(id.value())) {
+					Table<T,Tuple,Policy,IdRef>::Erase(p->Hash(), &p->value);
+				}
+			}
+	}
+
+	//---- Handles -------------------------------------------------------------
+	//
+	//	Handle<T,Tuple=void,Policy=policy::Default>:
+	//		A Handle is an alternative to the std::shared_ptr returned by
+	//		MakeInterned(). You get one from MakeHandle() (see below). It is the
+	//		size of a plain pointer, and the reference count it manipulates
+	//		lives right next to the interned object in the table entry, so
+	//		there is no separate control block to allocate. Each unique object
+	//		therefore costs a single allocation.
+	//
+	//		Handles behave much like shared pointers to const T: they can be
+	//		copied, moved, dereferenced, compared (by address), and reset.
+	//		There is no weak counterpart. A Handle also knows the hash value of
+	//		its object, which hash() returns in constant time. std::hash is
+	//		specialized to use it, so Handles make cheap keys for unordered
+	//		containers.
+
+	template<typename T, typename Tuple, typename Policy>
+		class Handle {
+		public:
+			Handle() noexcept = default;
+			Handle(const Handle& h) noexcept: mEntry{h.mEntry} {
+				if(mEntry) {
+					mEntry->ref.fetch_add(1u, std::memory_order_relaxed);
+				}
+			}
+			Handle(Handle&& h) noexcept: mEntry{h.mEntry} {
+				h.mEntry = nullptr;
+			}
+			auto operator = (Handle h) noexcept -> Handle& {
+				swap(h);
+				return *this;
+			}
+			~Handle() {
+				reset();
+			}
+
+			void reset() noexcept {
+				if(mEntry &&
+					mEntry->ref.fetch_sub(1u, std::memory_order_acq_rel) == 1u)
+				{
+					TRef::Release(*mEntry);
+				}
+				mEntry = nullptr;
+			}
+			void swap(Handle& h) noexcept {
+				std::swap(mEntry, h.mEntry);
+			}
+
+			auto get() const noexcept -> const T* {
+				return mEntry ? &mEntry->value : nullptr;
+			}
+			auto operator * () const noexcept -> const T& {
+				return mEntry->value;
+			}
+			auto operator -> () const noexcept -> const T* {
+				return &mEntry->value;
+			}
+			explicit operator bool () const noexcept {
+				return mEntry != nullptr;
+			}
+
+			//	Returns the object's hash value (as computed by the table when
+			//	it was interned), or 0 for an empty Handle. This is also what
+			//	std::hash<Handle> returns, except with policy::Compact, where
+			//	hash() must hash the object again and std::hash hashes its
+			//	address instead.
+			auto hash() const noexcept -> std::size_t {
+				return mEntry ? mEntry->Hash() : 0;
+			}
+
+			friend auto operator == (const Handle& a, const Handle& b) noexcept {
+				return a.mEntry == b.mEntry;
+			}
+			friend auto operator != (const Handle& a, const Handle& b) noexcept {
+				return a.mEntry != b.mEntry;
+			}
+
+		private:
+			using TRef = details::HandleRef<T,Tuple,Policy>;
+			friend TRef;
+
+			explicit Handle(typename TRef::TEntry* p) noexcept: mEntry{p} {}
+
+			typename TRef::TEntry* mEntry = nullptr;
+		};
+
+	//	Id<T,Tuple=void,Policy=policy::Default>:
+	//		An Id is a 32-bit alternative to a Handle, returned by MakeId()
+	//		(see below). It is a dense index into a slot table kept per
+	//		T/Tuple/Policy, so dereferencing it is an array look-up, comparing
+	//		two Ids is an integer compare, and copying one is a plain 4-byte
+	//		copy with no reference count to update.
+	//
+	//		The price is that Ids do not keep their objects alive. Instead,
+	//		MakeId() pins the object until you call Unpin() on its Id (or any
+	//		copy of it, since every Id for the same object is the same). After
+	//		that, all copies dangle like raw pointers, and the index may be
+	//		reused for a different object. A default-constructed Id is empty,
+	//		with value() 0.
+
+	template<typename T, typename Tuple, typename Policy>
+		class Id {
+		public:
+			Id() noexcept = default;
+
+			auto value() const noexcept -> std::uint32_t {
+				return mIndex;
+			}
+			auto get() const noexcept -> const T* {
+				return mIndex ? &TRef::gSlots.At(mIndex)->value : nullptr;
+			}
+			auto operator * () const noexcept -> const T& {
+				return TRef::gSlots.At(mIndex)->value;
+			}
+			auto operator -> () const noexcept -> const T* {
+				return &TRef::gSlots.At(mIndex)->value;
+			}
+			explicit operator bool () const noexcept {
+				return mIndex != 0;
+			}
+
+			friend auto operator == (Id a, Id b) noexcept {
+				return a.mIndex == b.mIndex;
+			}
+			friend auto operator != (Id a, Id b) noexcept {
+				return a.mIndex != b.mIndex;
+			}
+
+		private:
+			using TRef = details::IdRef<T,Tuple,Policy>;
+			friend TRef;
+
+			explicit Id(std::uint32_t i) noexcept: mIndex{i} {}
+
+			std::uint32_t mIndex = 0;
+		};
+
+	//---- Internment Utilities  -----------------------------------------------
+	//
+	//	MakeInterned<T,Tuple=void,Policy=policy::Default>(args...)
+	//	-> std::shared_ptr<const T>:
+	//		Returns a shared pointer to an immutable type T initialized with
+	//		any args you supply. MakeInterned() checks if a pointer with those
+	//		same args is already in use, in which case it returns said pointer
+	//		rather than allocating a fresh one.
+	//
+	//		By default, the data type T needs to be hashable and equality-
+	//		comparable. That's because MakeInterned() tracks objects in an
+	//		internal hash table keyed on T values. While this might be fine for
+	//		built-in classes like std::string that already meet these criteria,
+	//		it can be a bit onerous to add this functionality to custom classes
+	//		you are writing. This is where the Tuple template arg may help?
+	//
+	//		If you supply Tuple, it should be a tuple-like data type such as
+	//		std::tuple, std::pair, or std::array in which every element is
+	//		hashable and equality-comparable. By supplying this template arg,
+	//		you are telling MakeInterned() that your class can be static_cast
+	//		to that type. (It may inherit from the tuple class or implement a
+	//		conversion operator, explicit or not. Inheriting or returning a
+	//		const reference spares a copy of the tuple on each comparison.)
+	//		Tuples of integers, enums, and pointers with no padding between
+	//		them are hashed and compared as raw bytes. MakeInterned() can then
+	//		hash/compare your T values in tuple form, meaning you need not
+	//		implement std::hash<T> and so on.
+	//
+	//		On a hit, MakeInterned() avoids constructing a T where it can. If
+	//		you pass it a T, it looks that up directly. If T is a std::string
+	//		(or other std::basic_string), anything convertible to a string
+	//		view is looked up as such. And with policy::TupleArgs, the args are
+	//		looked up in Tuple form. Otherwise, a temporary T is constructed
+	//		from the args as before.
+	//
+	//		The Policy template arg selects how the internal table is organized
+	//		(see the Policies section above). Note that objects interned under
+	//		different policies live in different tables, so you should settle
+	//		on one policy per T/Tuple combination.
+
+	template<
+		typename T, typename Tuple=void, typename Policy=policy::Default,
+		typename... Args
+		>
+		auto MakeInterned(Args&&... args) {
+
+			using TTable = details::Table<T,Tuple,Policy>;
+
+			//	Get a look-up key for the input args. Where possible, this is a
+			//	light-weight view of the args, so that a T need only be
+			//	constructed if we fail to find one in the table.
+			auto probe = details::MakeProbe<T,Tuple,Policy>(
+				std::forward<Args>(args)...
+				);
+			auto hash = probe.Hash();
+
+			//	Look for the object in (or else add it to) whichever shard it
+			//	belongs to. (With policy::ThreadCache, the calling thread's
+			//	cache gets the first look.)
+			return TTable::Intern(hash, probe);
+		}
+
+	//	MakeHandle<T,Tuple=void,Policy=policy::Default>(args...)
+	//	-> Handle<T,Tuple,Policy>:
+	//		Works just like MakeInterned() but returns a Handle instead of a
+	//		std::shared_ptr. Objects interned through MakeHandle() live in a
+	//		separate table from those interned through MakeInterned(), so you
+	//		should stick to one or the other for a given T.
+
+	template<
+		typename T, typename Tuple=void, typename Policy=policy::Default,
+		typename... Args
+		>
+		auto MakeHandle(Args&&... args) -> Handle<T,Tuple,Policy> {
+			using TTable = details::Table<
+				T, Tuple, Policy, details::HandleRef<T,Tuple,Policy>
+				>;
+			auto probe = details::MakeProbe<T,Tuple,Policy>(
+				std::forward<Args>(args)...
+				);
+			auto hash = probe.Hash();
+			return TTable::Intern(hash, probe);
+		}
+
+	//	TryMakeInterned<T,Tuple=void,Policy=policy::Default>(args...)
+	//	-> std::shared_ptr<const T>:
+	//	TryMakeHandle<T,Tuple=void,Policy=policy::Default>(args...)
+	//	-> Handle<T,Tuple,Policy>:
+	//		Work just like MakeInterned() and MakeHandle() except that, rather
+	//		than wait for a shard mutex another thread is holding, they give
+	//		up and return a null result. A hit in the calling thread's cache
+	//		(with policy::ThreadCache) or in a policy::LockFreeReads table
+	//		needs no lock at all. Otherwise, the lock is only tried, and since
+	//		try_lock() may fail spuriously, a null result does not always mean
+	//		another thread was in the way. Rvalue args may have been moved
+	//		from either way (into a temporary T to look up, when they cannot
+	//		be looked up as they are), so pass lvalues if you mean to retry
+	//		with them, as InternService (see below) does. Note that letting
+	//		go of the last reference to an object still locks its shard to
+	//		erase it.
+
+	template<
+		typename T, typename Tuple=void, typename Policy=policy::Default,
+		typename... Args
+		>
+		auto TryMakeInterned(Args&&... args) -> std::shared_ptr<const T> {
+			using TTable = details::Table<T,Tuple,Policy>;
+			auto probe = details::MakeProbe<T,Tuple,Policy>(
+				std::forward<Args>(args)...
+				);
+			auto hash = probe.Hash();
+			return TTable::template Intern<true>(hash, probe);
+		}
+	template<
+		typename T, typename Tuple=void, typename Policy=policy::Default,
+		typename... Args
+		>
+		auto TryMakeHandle(Args&&... args) -> Handle<T,Tuple,Policy> {
+			using TTable = details::Table<
+				T, Tuple, Policy, details::HandleRef<T,Tuple,Policy>
+				>;
+			auto probe = details::MakeProbe<T,Tuple,Policy>(
+				std::forward<Args>(args)...
+				);
+			auto hash = probe.Hash();
+			return TTable::template Intern<true>(hash, probe);
+		}
+
+	//	HashOf<T,Tuple=void,Policy=policy::Default>(value) -> std::size_t:
+	//		Returns the hash value that the tables for T/Tuple/Policy file
+	//		value under. Keep it alongside a large object (or a view of one)
+	//		you will be interning more than once, and pass it to Intern() or
+	//		InternView() below to avoid rehashing.
+	//
+	//	Intern<T,Tuple=void,Policy=policy::Default>(value)
+	//	Intern<T,Tuple=void,Policy=policy::Default>(hash, value)
+	//	-> std::shared_ptr<const T>:
+	//		Interns the rvalue value (e.g. std::move(mesh)) into the same table
+	//		as MakeInterned(). On a hit, value is only compared, never moved
+	//		from, so it is still yours to use. On a miss, it is moved into the
+	//		table exactly once. The second form skips hashing value, taking
+	//		hash from HashOf() instead. (A wrong hash does no harm beyond
+	//		missing the existing copy, which then gets a duplicate, except
+	//		under policy::Compact, where the table later recomputes the hash
+	//		to find the entry again, so it must be right.)
+	//
+	//	InternView<T,Tuple=void,Policy=policy::Default>(hash, view, args...)
+	//	-> std::shared_ptr<const T>:
+	//		Looks up the T that view stands for without constructing one. The
+	//		view may be anything that stored T values compare equal to (with
+	//		== or, given a Tuple type for view, tuple-wise), and hash must be
+	//		the HashOf() the T would have. On a hit, nothing else is done. On a
+	//		miss, a T is constructed from args (or from view, if you pass none)
+	//		and moved into place, so pass the payload as an rvalue to have it
+	//		moved rather than copied.
+	//
+	//	InternHandle<T,Tuple=void,Policy=policy::Default>(value)
+	//	InternHandle<T,Tuple=void,Policy=policy::Default>(hash, value)
+	//	InternHandleView<T,Tuple=void,Policy=policy::Default>(hash, view, ...)
+	//	-> Handle<T,Tuple,Policy>:
+	//		The MakeHandle() counterparts to Intern() and InternView().
+
+	template<typename T, typename Tuple=void, typename Policy=policy::Default>
+		auto HashOf(const T& value) -> std::size_t {
+			return typename details::Map<T,Tuple,Policy>::Hash{}(value);
+		}
+	template<typename T, typename Tuple=void, typename Policy=policy::Default>
+		auto Intern(std::size_t hash, T&& value) {
+			static_assert(
+				!std::is_reference_v<T>,
+				"Intern() takes an rvalue; use MakeInterned() to copy"
+				);
+
+			//	The probe views value in place and only moves it into the
+			//	Entry on a miss.
+			auto probe = details::MakeProbe<T,Tuple,Policy>(std::move(value));
+			return details::Table<T,Tuple,Policy>::Intern(hash, probe);
+		}
+	template<typename T, typename Tuple=void, typename Policy=policy::Default>
+		auto Intern(T&& value) {
+			static_assert(
+				!std::is_reference_v<T>,
+				"Intern() takes an rvalue; use MakeInterned() to copy"
+				);
+			auto hash = HashOf<T,Tuple,Policy>(value);
+			return Intern<T,Tuple,Policy>(hash, std::move(value));
+		}
+	template<
+		typename T, typename Tuple=void, typename Policy=policy::Default,
+		typename View, typename... Args
+		>
+		auto InternView(std::size_t hash, const View& view, Args&&... args)
+			-> std::shared_ptr<const T>
+		{
+			return details::InternView<
+				T, Tuple, Policy, details::SharedRef<T,Tuple,Policy>
+				>(hash, view, std::forward<Args>(args)...);
+		}
+	template<typename T, typename Tuple=void, typename Policy=policy::Default>
+		auto InternHandle(std::size_t hash, T&& value) {
+			static_assert(
+				!std::is_reference_v<T>,
+				"InternHandle() takes an rvalue; use MakeHandle() to copy"
+				);
+			using TTable = details::Table<
+				T, Tuple, Policy, details::HandleRef<T,Tuple,Policy>
+				>;
+			auto probe = details::MakeProbe<T,Tuple,Policy>(std::move(value));
+			return TTable::Intern(hash, probe);
+		}
+	template<typename T, typename Tuple=void, typename Policy=policy::Default>
+		auto InternHandle(T&& value) {
+			static_assert(
+				!std::is_reference_v<T>,
+				"InternHandle() takes an rvalue; use MakeHandle() to copy"
+				);
+			auto hash = HashOf<T,Tuple,Policy>(value);
+			return InternHandle<T,Tuple,Policy>(hash, std::move(value));
+		}
+	template<
+		typename T, typename Tuple=void, typename Policy=policy::Default,
+		typename View, typename... Args
+		>
+		auto InternHandleView(
+			std::size_t hash, const View& view, Args&&... args
+			) -> Handle<T,Tuple,Policy>
+		{
+			return details::InternView<
+				T, Tuple, Policy, details::HandleRef<T,Tuple,Policy>
+				>(hash, view, std::forward<Args>(args)...);
+		}
+
+	//	MakeInternedBatch<T,Tuple=void,Policy=policy::Default>(
+	//		first, last, out
+	//		) -> OutputIt:
+	//		Interns every element of the forward range [first, last) as if by
+	//		MakeInterned<T,Tuple,Policy>(*it), writing the shared pointers to
+	//		out in the same order. Returns out advanced past the last one.
+	//
+	//		For large batches, this is a good deal cheaper than calling
+	//		MakeInterned() in a loop. The elements are hashed up front and
+	//		grouped by shard, so that each shard is locked only once, and
+	//		table memory is prefetched a few elements ahead. The catch is that
+	//		other threads interning the same type wait for the whole group.
+	//
+	//	MakeHandleBatch<T,Tuple=void,Policy=policy::Default>(first, last, out)
+	//	-> OutputIt:
+	//		The MakeHandle() counterpart to MakeInternedBatch().
+	//
+	//	MakeInternedParallel<T,Tuple=void,Policy=policy::Default>(
+	//		first, last, out, threads
+	//		) -> OutputIt:
+	//	MakeInternedParallel<T,Tuple=void,Policy=policy::Default>(
+	//		first, last, out, executor
+	//		) -> OutputIt:
+	//		Works like MakeInternedBatch(), but for building big tables from
+	//		scratch, it spreads the work over threads of its own (as many as
+	//		the hardware has, if threads is 0) or over whatever executor runs.
+	//		The elements are hashed in parallel slices. Then each thread takes
+	//		a disjoint set of shards and interns the elements belonging to
+	//		them, so that the threads never wait on each other's locks (only
+	//		on those of anyone else interning at the time). The results are
+	//		all in place by the time it returns. Since inserting only goes as
+	//		wide as the shards, use policy::Sharded with at least as many
+	//		shards as threads. Elements are read from several threads at once.
+	//
+	//		An executor is anything callable as executor(n, task) that calls
+	//		task(i) for each i in [0, n), concurrently or not, and returns once
+	//		every call has. Handing tasks to your own thread pool this way
+	//		spares starting threads. With an executor, the range is hashed in
+	//		as many slices as the hardware has threads. If a task throws, the
+	//		first exception is rethrown after the rest are done.
+	//
+	//	MakeHandleParallel<T,Tuple=void,Policy=policy::Default>(
+	//		first, last, out, threads
+	//		) -> OutputIt:
+	//	MakeHandleParallel<T,Tuple=void,Policy=policy::Default>(
+	//		first, last, out, executor
+	//		) -> OutputIt:
+	//		The MakeHandle() counterpart to MakeInternedParallel().
+
+	template<
+		typename T, typename Tuple=void, typename Policy=policy::Default,
+		typename ForwardIt, typename OutputIt
+		>
+		auto MakeInternedBatch(ForwardIt first, ForwardIt last, OutputIt out)
+			-> OutputIt
+		{
+			return details::Table<T,Tuple,Policy>::InternBatch(
+				first, last, out
+				);
+		}
+	template<
+		typename T, typename Tuple=void, typename Policy=policy::Default,
+		typename ForwardIt, typename OutputIt
+		>
+		auto MakeHandleBatch(ForwardIt first, ForwardIt last, OutputIt out)
+			-> OutputIt
+		{
+			using TTable = details::Table<
+				T, Tuple, Policy, details::HandleRef<T,Tuple,Policy>
+				>;
+			return TTable::InternBatch(first, last, out);
+		}
+
+	namespace details {
+
+		//	ThreadExecutor is the executor MakeInternedParallel() uses when
+		//	given a thread count. It runs task 0 on the calling thread and the
+		//	rest on threads of their own.
+		struct ThreadExecutor {
+			template<typename Task>
+				void operator () (std::size_t n, Task&& task) const {
+					std::vector<std::thread> threads;
+					threads.reserve(n - 1);
+					try {
+						for(std::size_t i = 1; i < n; ++i) {
+							threads.emplace_back([&task, i] { task(i); });
+						}
+					}
+					catch(...) {
+						for(auto& thread: threads) {
+							thread.join();
+						}
+						throw;
+					}
+					task(0);
+					for(auto& thread: threads) {
+						thread.join();
+					}
+				}
+		};
+
+		//	InternParallel() turns the workers passed to MakeInternedParallel()
+		//	or MakeHandleParallel() into an executor and a number of tasks.
+		template<typename TTable, typename It, typename Out, typename Workers>
+			auto InternParallel(It first, It last, Out out, Workers&& workers)
+				-> Out
+			{
+				std::size_t hardware = std::max(
+					std::thread::hardware_concurrency(), 1u
+					);
+				if constexpr(std::is_integral_v<std::decay_t<Workers>>) {
+					auto threads = workers > 0 ?
+						static_cast<std::size_t>(workers) : hardware;
+					return TTable::InternParallel(
+						first, last, out, threads, ThreadExecutor{}
+						);
+				}
+				else {
+					return TTable::InternParallel(
+						first, last, out, hardware, workers
+						);
+				}
+			}
+	}
+
+	template<
+		typename T, typename Tuple=void, typename Policy=policy::Default,
+		typename ForwardIt, typename OutputIt, typename Workers
+		>
+		auto MakeInternedParallel(
+			ForwardIt first, ForwardIt last, OutputIt out, Workers&& workers
+			) -> OutputIt
+		{
+			return details::InternParallel<details::Table<T,Tuple,Policy>>(
+				first, last, out, std::forward<Workers>(workers)
+				);
+		}
+	template<
+		typename T, typename Tuple=void, typename Policy=policy::Default,
+		typename ForwardIt, typename OutputIt, typename Workers
+		>
+		auto MakeHandleParallel(
+			ForwardIt first, ForwardIt last, OutputIt out, Workers&& workers
+			) -> OutputIt
+		{
+			using TTable = details::Table<
+				T, Tuple, Policy, details::HandleRef<T,Tuple,Policy>
+				>;
+			return details::InternParallel<TTable>(
+				first, last, out, std::forward<Workers>(workers)
+				);
+		}
+
+	//	MakeId<T,Tuple=void,Policy=policy::Default>(args...)
+	//	-> Id<T,Tuple,Policy>:
+	//		Works like MakeInterned() but returns an Id, pinning the object
+	//		until Unpin() is called on it. As with MakeHandle(), objects with
+	//		Ids live in a table of their own.
+	//
+	//	Unpin(id):
+	//		Releases the object pinned by MakeId(), erasing it from the table
+	//		(or, with policy::DeferredErase, retiring it). Unpinning an empty
+	//		or already unpinned Id does nothing (so long as its index has not
+	//		been handed out again since). But make sure nobody else is still
+	//		using the Id or is about to get it back from MakeId().
+
+	template<
+		typename T, typename Tuple=void, typename Policy=policy::Default,
+		typename... Args
+		>
+		auto MakeId(Args&&... args) -> Id<T,Tuple,Policy> {
+			using TTable = details::Table<
+				T, Tuple, Policy, details::IdRef<T,Tuple,Policy>
+				>;
+			auto probe = details::MakeProbe<T,Tuple,Policy>(
+				std::forward<Args>(args)...
+				);
+			auto hash = probe.Hash();
+			return TTable::Intern(hash, probe);
+		}
+	template<typename T, typename Tuple, typename Policy>
+		void Unpin(Id<T,Tuple,Policy> id) {
+			details::IdRef<T,Tuple,Policy>::Unpin(id);
+		}
+
+	//	Collect<T,Tuple=void,Policy=policy::Default>():
+	//		With policy::DeferredErase, erases every entry the calling thread
+	//		has released but not yet erased from the tables behind
+	//		MakeInterned(), MakeHandle(), and MakeId(). Other threads' retire
+	//		lists are left alone. With policy::ThreadCache, it also empties
+	//		the calling thread's cache first, releasing the references held
+	//		there. Without either policy, this does nothing.
+
+	template<typename T, typename Tuple=void, typename Policy=policy::Default>
+		void Collect() {
+			details::Table<T,Tuple,Policy>::Collect();
+			details::Table<
+				T, Tuple, Policy, details::HandleRef<T,Tuple,Policy>
+				>::Collect();
+			details::Table<
+				T, Tuple, Policy, details::IdRef<T,Tuple,Policy>
+				>::Collect();
+		}
+
+	//	Stats<T,Tuple=void,Policy=policy::Default>() -> TableStats:
+	//		Takes stock of the tables behind MakeInterned(), MakeHandle(), and
+	//		MakeId() for T/Tuple/Policy (see TableStats above). Each shard is
+	//		locked in turn while it is examined, so this is not something to
+	//		call in a tight loop, and other threads may change the picture as
+	//		it is being put together. Without policy::WithStats, the counts
+	//		and lock waits come back zero.
+
+	template<typename T, typename Tuple=void, typename Policy=policy::Default>
+		auto Stats() -> TableStats {
+			TableStats stats;
+			stats.shardSizes.resize(Policy::kShards);
+			details::Table<T,Tuple,Policy>::AddStats(stats);
+			details::Table<
+				T, Tuple, Policy, details::HandleRef<T,Tuple,Policy>
+				>::AddStats(stats);
+			details::Table<
+				T, Tuple, Policy, details::IdRef<T,Tuple,Policy>
+				>::AddStats(stats);
+			return stats;
+		}
+
+	//	Reserve<T,Tuple=void,Policy=policy::Default>(n):
+	//	ReserveHandles<T,Tuple=void,Policy=policy::Default>(n):
+	//	ReserveIds<T,Tuple=void,Policy=policy::Default>(n):
+	//		Grows the table behind MakeInterned(), MakeHandle(), or MakeId()
+	//		respectively so that it can hold n objects without rehashing.
+	//		Call this before interning a batch whose size you can estimate
+	//		(when loading a file, say) to get the rehashing out of the way
+	//		while no other thread needs the table. Reserving never shrinks a
+	//		table, and each shard is locked in turn while it grows.
+
+	template<typename T, typename Tuple=void, typename Policy=policy::Default>
+		void Reserve(std::size_t n) {
+			details::Table<T,Tuple,Policy>::Reserve(n);
+		}
+	template<typename T, typename Tuple=void, typename Policy=policy::Default>
+		void ReserveHandles(std::size_t n) {
+			details::Table<
+				T, Tuple, Policy, details::HandleRef<T,Tuple,Policy>
+				>::Reserve(n);
+		}
+	template<typename T, typename Tuple=void, typename Policy=policy::Default>
+		void ReserveIds(std::size_t n) {
+			details::Table<
+				T, Tuple, Policy, details::IdRef<T,Tuple,Policy>
+				>::Reserve(n);
+		}
+
+	//---- Interning Services --------------------------------------------------
+	//
+	//	InternService<T,Tuple=void,Policy=policy::Default>:
+	//		An InternService owns a thread that calls MakeInterned() on behalf
+	//		of threads that must never block on a shard mutex, such as the
+	//		one running an event loop. Each request first tries
+	//		TryMakeInterned() on the calling thread. Only if that comes back
+	//		null are the args copied (or moved) into a queue, from which the
+	//		service thread takes them to intern the usual way. The service
+	//		thread is the only one that ever waits on the table for you.
+	//
+	//		Destroying the service finishes whatever is still queued before
+	//		joining its thread.
+	//
+	//	InternService<T,Tuple,Policy>::MakeInterned(done, args...):
+	//		Calls done with the std::shared_ptr<const T> that MakeInterned()
+	//		would give you for args. This happens before MakeInterned()
+	//		returns if TryMakeInterned() succeeds, and on the service thread
+	//		later otherwise, so done should post the result back to your
+	//		loop if it needs to run there. On the service thread, done gets a
+	//		null pointer if interning throws. It must not throw itself.
+	//
+	//	InternService<T,Tuple,Policy>::Await(args...) -> awaitable:
+	//		Returns an object that a C++20 coroutine can co_await for the
+	//		std::shared_ptr<const T>. (Nothing here needs C++20 itself.) The
+	//		args are copied into the awaitable. If TryMakeInterned() succeeds,
+	//		the coroutine never suspends. Otherwise, it is resumed on the
+	//		service thread once the object is interned, and co_await rethrows
+	//		anything interning threw. Like done above, the coroutine can hop
+	//		back to your loop afterwards if it needs to.
+	//
+	//	InternService<T,Tuple,Policy>::Release(p):
+	//		Drops p on the service thread. If p might be the last reference
+	//		to its object, releasing it yourself would lock a shard to erase
+	//		it, so hand it off here instead.
+
+	template<typename T, typename Tuple=void, typename Policy=policy::Default>
+		class InternService {
+		public:
+			using Result = std::shared_ptr<const T>;
+
+			template<typename... Args> class Awaitable;
+
+			InternService(): mThread{[this] { Run(); }} {}
+			InternService(const InternService&) = delete;
+			auto operator = (const InternService&) -> InternService& = delete;
+			~InternService() {
+				{
+					std::lock_guard<std::mutex> lg{mMutex};
+					mStopping = true;
+				}
+				mWake.notify_one();
+				mThread.join();
+			}
+
+			template<typename Done, typename... Args>
+				void MakeInterned(Done&& done, Args&&... args) {
+
+					//	The args are copied up front, since TryMakeInterned()
+					//	may move from rvalues even when it fails. It gets
+					//	lvalues of the copies instead, which go to the queue.
+					auto copies = std::make_tuple(std::forward<Args>(args)...);
+					if(auto result = std::apply(
+						[](auto&... args) {
+							return TryMakeInterned<T,Tuple,Policy>(args...);
+						},
+						copies))
+					{
+						done(std::move(result));
+						return;
+					}
+					Enqueue(
+						[	done = std::forward<Done>(done),
+							args = std::move(copies)
+						]() mutable {
+							Result result;
+							try {
+								result = Intern(std::move(args));
+							}
+							catch(...) {
+							}
+							done(std::move(result));
+						});
+				}
+
+			template<typename... Args>
+				auto Await(Args&&... args) -> Awaitable<std::decay_t<Args>...> {
+					return Awaitable<std::decay_t<Args>...>{
+						*this, std::forward<Args>(args)...
+						};
+				}
+
+			void Release(Result p) {
+				if(p) {
+					Enqueue([p = std::move(p)] {});
+				}
+			}
+
+			template<typename... Args>
+				class Awaitable {
+				public:
+					template<typename... Ins>
+						Awaitable(InternService& service, Ins&&... args):
+							mService{service},
+							mArgs{std::forward<Ins>(args)...} {}
+
+					auto await_ready() -> bool {
+						mResult = std::apply(
+							[](auto&... args) {
+								return TryMakeInterned<T,Tuple,Policy>(args...);
+							},
+							mArgs);
+						return mResult != nullptr;
+					}
+					template<typename Coroutine>
+						void await_suspend(Coroutine coroutine) {
+							mService.Enqueue([this, coroutine]() mutable {
+								try {
+									mResult = Intern(std::move(mArgs));
+								}
+								catch(...) {
+									mError = std::current_exception();
+								}
+								coroutine.resume();
+							});
+						}
+					auto await_resume() -> Result {
+						if(mError) {
+							std::rethrow_exception(mError);
+						}
+						return std::move(mResult);
+					}
+
+				private:
+					InternService& mService;
+					std::tuple<Args...> mArgs;
+					Result mResult;
+					std::exception_ptr mError;
+				};
+
+		private:
+			struct Job {
+				virtual ~Job() = default;
+				virtual void Run() noexcept = 0;
+			};
+			template<typename F>
+				struct JobFor: Job {
+					F f;
+					explicit JobFor(F&& f): f{std::move(f)} {}
+					void Run() noexcept override { f(); }
+				};
+
+			std::mutex mMutex;
+			std::condition_variable mWake;
+			std::vector<std::unique_ptr<Job>> mJobs;
+			bool mStopping = false;
+			std::thread mThread;  // last, so that it starts once all is set
+
+			template<typename Args>
+				static auto Intern(Args&& args) -> Result {
+					return std::apply(
+						[](auto&&... args) {
+							return intern::MakeInterned<T,Tuple,Policy>(
+								std::forward<decltype(args)>(args)...
+								);
+						},
+						std::forward<Args>(args));
+				}
+
+			template<typename F>
+				void Enqueue(F&& f) {
+					auto job = std::make_unique<JobFor<std::decay_t<F>>>(
+						std::forward<F>(f)
+						);
+					{
+						std::lock_guard<std::mutex> lg{mMutex};
+						mJobs.push_back(std::move(job));
+					}
+					mWake.notify_one();
+				}
+
+			//	Run() takes the whole queue at once and works through it
+			//	unlocked. The jobs are destroyed there too, so that whatever
+			//	references they captured are released off the caller's thread.
+			void Run() {
+				std::vector<std::unique_ptr<Job>> jobs;
+				std::unique_lock<std::mutex> lk{mMutex};
+				for(;;) {
+					mWake.wait(lk, [this] {
+						return mStopping || !mJobs.empty();
+					});
+					if(mJobs.empty()) {
+						return;
+					}
+					jobs.swap(mJobs);
+					lk.unlock();
+					for(auto& job: jobs) {
+						job->Run();
+					}
+					jobs.clear();
+					lk.lock();
+				}
+			}
+		};
+
+	//---- Pools ---------------------------------------------------------------
+	//
+	//	Pool<T,Tuple=void,Policy=policy::Default>:
+	//		A Pool is a self-contained interning table you can create for a
+	//		document, a scene, a request, or any other context with a clear
+	//		end. Objects interned through its MakeInterned() member are shared
+	//		only with that pool, and pools never contend with each other (or
+	//		with the global tables) for locks.
+	//
+	//		In exchange, a pool keeps everything it interns until it is
+	//		destroyed itself. Its MakeInterned() returns a plain const T*,
+	//		which you can compare, copy, and dereference for free, but which
+	//		dangles once the pool is gone. Each shard allocates its entries
+	//		from a std::pmr::monotonic_buffer_resource (drawing on whatever
+	//		std::pmr::get_default_resource() returns when the pool is
+	//		constructed), and releases the whole arena at once on destruction.
+	//		If T is trivially destructible and the policy uses the default
+	//		Backend, nothing else is done, so the pool is torn down in constant
+	//		time no matter how many objects it holds. Otherwise, each object's
+	//		destructor is still run.
+	//
+	//		The Policy works as it does for the global functions, except that
+	//		its Allocator and the pooling, erasure, retention, and thread-cache
+	//		policies do not apply. Combine policy::SingleThread with a pool
+	//		that only one thread uses at a time to drop its locking too.
+	//		Pools can be neither copied nor moved.
+	//
+	//		Besides MakeInterned(), a pool has Reserve() (see intern::Reserve()
+	//		above) and ForEach(f), which calls f(value) on every object in the
+	//		pool (e.g. to write them to a Snapshot).
+
+	template<typename T, typename Tuple=void, typename Policy=policy::Default>
+		class Pool {
+		public:
+			Pool() = default;
+			Pool(const Pool&) = delete;
+			auto operator = (const Pool&) = delete;
+
+			template<typename... Args>
+				auto MakeInterned(Args&&... args) -> const T* {
+					auto probe = details::MakeProbe<T,Tuple,TPolicy>(
+						std::forward<Args>(args)...
+						);
+					auto hash = probe.Hash();
+					return mParts[TTable::ShardIndex(hash)].shard.Intern(
+						hash, probe
+						);
+				}
+
+			//	Reserve() works like intern::Reserve() but for this pool.
+			void Reserve(std::size_t n) {
+				auto share = (n + TPolicy::kShards - 1) / TPolicy::kShards;
+				if constexpr(TPolicy::kShards > 1) {
+					share += share / 8u;
+				}
+				for(auto& part: mParts) {
+					part.shard.Reserve(share);
+				}
+			}
+
+			//	ForEach() calls f(value) for every object in the pool, in no
+			//	particular order. Each shard is locked while it is visited,
+			//	so f must not intern anything into this pool.
+			template<typename F>
+				void ForEach(F f) {
+					for(auto& part: mParts) {
+						part.shard.ForEach([&f](const auto& entry) {
+							f(entry.value);
+						});
+					}
+				}
+
+		private:
+			using TPolicy = details::PoolPolicy<Policy>;
+			using TTable = details::Table<
+				T, Tuple, TPolicy, details::PoolRef<T,Tuple,TPolicy>
+				>;
+			using Shard = typename TTable::Shard;
+
+			//	A map shard allocates everything from its arena, so there is
+			//	no need to walk it on destruction unless the objects
+			//	themselves need destroying.
+			static constexpr bool kSkipTeardown =
+				TPolicy::kBackend == policy::Backend::kMap &&
+				std::is_trivially_destructible_v<T>;
+
+			//	Each Part's shard sits in a union so that it can be left
+			//	undestroyed when its arena is released.
+			struct Part {
+				std::pmr::monotonic_buffer_resource arena;
+				union {
+					Shard shard;
+				};
+
+				Part(): shard{typename TPolicy::Allocator{&arena}} {}
+				Part(const Part&) = delete;
+				auto operator = (const Part&) = delete;
+				~Part() {
+					if constexpr(!kSkipTeardown) {
+						shard.~Shard();
+					}
+				}
+			};
+
+			std::array<Part,TPolicy::kShards> mParts;
+		};
+
+	//---- Snapshots -----------------------------------------------------------
+	//
+	//	Snapshot<T,Hasher=WyHasher>:
+	//		A Snapshot is a read-only set of interned values laid out in one
+	//		block of memory, normally a file mapped in with mmap(). Looking up
+	//		a value takes no locks and copies nothing, and each value is stored
+	//		once, so the results can be compared by address just like pointers
+	//		from MakeInterned(). The idea is to intern a large, known set of
+	//		values (config strings, say) ahead of time with Write(), so that
+	//		starting up costs little more than paging in whatever parts of the
+	//		file get used.
+	//
+	//		T must be either trivially copyable or a std::basic_string. The
+	//		former are hashed and compared as raw bytes, so steer clear of
+	//		padding and floating point members. For the latter, only the
+	//		characters are stored, followed by a null terminator. Accordingly,
+	//		a Snapshot's Key type is either T or T's std::basic_string_view,
+	//		and its Result type is either a const T* or a string view, pointing
+	//		into the Snapshot. (A missing value gives a null pointer or a view
+	//		whose data() is null.)
+	//
+	//		The file starts with a header giving the format version, the size
+	//		of T (or of a character), and a check value from Hasher. Next is a
+	//		power-of-2 table of slots holding each value's hash and offset in
+	//		the file, and then the values themselves. Numbers are stored in the
+	//		machine's own byte order, so a file is only good on machines like
+	//		the one that wrote it. Opening one that does not match throws
+	//		std::runtime_error. (The slot table itself is trusted, so that
+	//		opening a file need not read all of it.)
+	//
+	//		Snapshots are cheap to copy. Copies share the same block, which is
+	//		unmapped (or freed) once the last of them is gone.
+	//
+	//	Snapshot<T,Hasher>::Write(out, first, last):
+	//	Snapshot<T,Hasher>::Write(out, pool):
+	//		Writes the distinct values in the forward range [first, last) (whose
+	//		elements must be convertible to Key), or in a Pool of T, to out. The
+	//		std::ostream should be in binary mode.
+	//
+	//	Snapshot<T,Hasher>::Open(path) -> Snapshot:
+	//		Maps in a file written by Write(). Without INTERN_MMAP (which
+	//		defaults to 1 where <sys/mman.h> is available), the file is read
+	//		into memory instead.
+	//
+	//	Snapshot<T,Hasher>(data, size):
+	//		Uses a block you have mapped or loaded yourself. It must be aligned
+	//		to kAlign bytes and outlive the Snapshot and its results.
+	//
+	//	Snapshot<T,Hasher>::Find(key) -> Result:
+	//	Snapshot<T,Hasher>::size() -> std::size_t:
+	//		Look up key, or return how many values there are.
+
+	namespace details {
+
+		//	A Snapshot block starts with a SnapshotHeader followed by its
+		//	slots. Offsets are from the start of the block, and an offset of 0
+		//	marks an empty slot.
+		struct SnapshotHeader {
+			char magic[8];
+			std::uint32_t version;
+			std::uint32_t unit;  // sizeof(T), or kStringUnit | sizeof(char)
+			std::uint64_t check;
+			std::uint64_t count;
+			std::uint64_t slots;
+			std::uint64_t size;
+		};
+		struct SnapshotSlot {
+			std::uint64_t hash;
+			std::uint64_t offset;
+		};
+	}
+
+	template<typename T, typename Hasher=WyHasher>
+		class Snapshot {
+			using StringView = typename details::StringView<T>::Type;
+			static constexpr bool kString = !std::is_void_v<StringView>;
+
+			static_assert(
+				kString || std::is_trivially_copyable_v<T>,
+				"Snapshot requires a trivially copyable T or a std::basic_string"
+				);
+
+		public:
+			using Key = std::conditional_t<kString, StringView, T>;
+			using Result = std::conditional_t<kString, Key, const T*>;
+
+			static constexpr std::size_t kAlign =
+				std::max(alignof(T), alignof(details::SnapshotHeader));
+
+			Snapshot(const void* data, std::size_t size):
+				mBase{static_cast<const unsigned char*>(data)}
+			{
+				if(reinterpret_cast<std::uintptr_t>(data) % kAlign) {
+					Fail("misaligned block");
+				}
+				if(size < sizeof(details::SnapshotHeader)) {
+					Fail("truncated block");
+				}
+				auto& header = Header();
+				if(	std::memcmp(header.magic, kMagic, sizeof kMagic) != 0 ||
+					header.version != kVersion
+					)
+				{
+					Fail("not a snapshot, or an unsupported version");
+				}
+				if(header.unit != kUnit || header.check != Check()) {
+					Fail("written for another type or Hasher");
+				}
+				auto slots = header.slots;
+				if(	header.size != size || !slots || (slots & (slots - 1u)) ||
+					slots > (size - sizeof header) / sizeof(details::SnapshotSlot)
+					)
+				{
+					Fail("corrupt header");
+				}
+			}
+
+			static auto Open(const std::string& path) -> Snapshot {
+				std::shared_ptr<const void> owner;
+				std::size_t size = 0;
+			 #if INTERN_MMAP
+				if(auto fd = ::open(path.c_str(), O_RDONLY); fd >= 0) {
+					struct stat st;
+					if(::fstat(fd, &st) == 0 && st.st_size > 0) {
+						size = static_cast<std::size_t>(st.st_size);
+						auto p = ::mmap(
+							nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0
+							);
+						if(p != MAP_FAILED) {
+							owner.reset(p, [size](const void* q) {
+								::munmap(const_cast<void*>(q), size);
+							});
+						}
+					}
+					::close(fd);
+				}
+			 #else
+				if(std::ifstream in{path, std::ios::binary | std::ios::ate}) {
+					size = static_cast<std::size_t>(in.tellg());
+					auto p = ::operator new(size, std::align_val_t{kAlign});
+					owner.reset(p, [](const void* q) {
+						::operator delete(
+							const_cast<void*>(q), std::align_val_t{kAlign}
+							);
+					});
+					in.seekg(0);
+					if(!in.read(
+						static_cast<char*>(p),
+						static_cast<std::streamsize>(size)
+						))
+					{
+						owner.reset();
+					}
+				}
+			 #endif
+				if(!owner) {
+					Fail(("cannot read " + path).c_str());
+				}
+				Snapshot snapshot{owner.get(), size};
+				snapshot.mOwner = std::move(owner);
+				return snapshot;
+			}
+
+			template<typename ForwardIt>
+				static void Write(
+					std::ostream& out, ForwardIt first, ForwardIt last
+					)
+				{
+					std::vector<Key> keys;
+					keys.reserve(
+						static_cast<std::size_t>(std::distance(first, last))
+						);
+					for(; first != last; ++first) {
+						keys.push_back(Key(*first));
+					}
+					WriteKeys(out, keys);
+				}
+			template<typename Tuple, typename Policy>
+				static void Write(
+					std::ostream& out, Pool<T,Tuple,Policy>& pool
+					)
+				{
+					std::vector<Key> keys;
+					pool.ForEach([&keys](const T& value) {
+						keys.push_back(Key(value));
+					});
+					WriteKeys(out, keys);
+				}
+
+			auto Find(const Key& key) const -> Result {
+				auto slots = reinterpret_cast<const details::SnapshotSlot*>(
+					mBase + sizeof(details::SnapshotHeader)
+					);
+				auto hash = Hash(key);
+				auto mask = Header().slots - 1u;
+				for(auto i = hash;; ++i) {
+					auto& slot = slots[i & mask];
+					if(!slot.offset) {
+						return Result{};
+					}
+					if(auto result = At(slot.offset);
+						slot.hash == hash && Same(View(result), key))
+					{
+						return result;
+					}
+				}
+			}
+			auto size() const noexcept -> std::size_t {
+				return static_cast<std::size_t>(Header().count);
+			}
+
+		private:
+			static constexpr char kMagic[8] = {
+				'i', 'n', 't', 'e', 'r', 'n', 'S', 'n'
+				};
+			static constexpr std::uint32_t kVersion = 1;
+			static constexpr std::uint32_t kStringUnit = 0x80000000u;
+			static constexpr std::uint32_t kUnit = [] {
+				if constexpr(kString) {
+					return kStringUnit | static_cast<std::uint32_t>(
+						sizeof(typename StringView::value_type)
+						);
+				}
+				else {
+					return static_cast<std::uint32_t>(sizeof(T));
+				}
+			}();
+
+			const unsigned char* mBase;
+			std::shared_ptr<const void> mOwner;
+
+			[[noreturn]] static void Fail(const char* why) {
+				throw std::runtime_error{
+					std::string{"intern::Snapshot: "} + why
+					};
+			}
+			auto Header() const -> const details::SnapshotHeader& {
+				return *reinterpret_cast<const details::SnapshotHeader*>(mBase);
+			}
+
+			//	Hashing a fixed string lets the constructor tell whether the
+			//	block was written with the same Hasher.
+			static auto Check() -> std::uint64_t {
+				return Hasher::HashBytes(kMagic, sizeof kMagic);
+			}
+			static auto Hash(const Key& key) -> std::uint64_t {
+				if constexpr(kString) {
+					return Hasher::HashBytes(
+						key.data(), key.size() * sizeof(key[0])
+						);
+				}
+				else {
+					return Hasher::HashBytes(&key, sizeof key);
+				}
+			}
+			static auto Same(const Key& a, const Key& b) -> bool {
+				if constexpr(kString) {
+					return a == b;
+				}
+				else {
+					return std::memcmp(&a, &b, sizeof a) == 0;
+				}
+			}
+
+			//	A stored string is preceded by its length.
+			auto At(std::uint64_t offset) const -> Result {
+				auto p = mBase + offset;
+				if constexpr(kString) {
+					std::uint64_t n;
+					std::memcpy(&n, p - sizeof n, sizeof n);
+					return Result{
+						reinterpret_cast<const typename Key::value_type*>(p),
+						static_cast<std::size_t>(n)
+						};
+				}
+				else {
+					return reinterpret_cast<const T*>(p);
+				}
+			}
+			static auto View(const Result& result) -> const Key& {
+				if constexpr(kString) {
+					return result;
+				}
+				else {
+					return *result;
+				}
+			}
+
+			//	The bytes a stored value takes, including a string's null.
+			static auto Bytes(const Key& key) -> std::uint64_t {
+				if constexpr(kString) {
+					return (key.size() + 1u) * sizeof(key[0]);
+				}
+				else {
+					return sizeof key;
+				}
+			}
+			static void Pad(std::ostream& out, std::uint64_t n) {
+				static constexpr char kZeros[16] = {};
+				for(; n > sizeof kZeros; n -= sizeof kZeros) {
+					out.write(kZeros, sizeof kZeros);
+				}
+				out.write(kZeros, static_cast<std::streamsize>(n));
+			}
+
+			//	WriteKeys() drops duplicate keys as it fills a slot table no
+			//	more than half full. It then lays out the values after the
+			//	table in the order they first appeared.
+			static void WriteKeys(
+				std::ostream& out, const std::vector<Key>& keys
+				)
+			{
+				using details::SnapshotHeader;
+				using details::SnapshotSlot;
+
+				std::uint64_t slotCount = 8;
+				while(slotCount < 2u * keys.size()) {
+					slotCount <<= 1;
+				}
+				std::vector<SnapshotSlot> slots(slotCount);
+				std::vector<const Key*> unique;
+				for(auto& key: keys) {
+					auto hash = Hash(key);
+					for(auto i = hash;; ++i) {
+						auto& slot = slots[i & (slotCount - 1u)];
+						if(!slot.offset) {
+							unique.push_back(&key);
+							slot = {hash, unique.size()};
+							break;
+						}
+						if(	slot.hash == hash &&
+							Same(*unique[slot.offset - 1u], key)
+							)
+						{
+							break;
+						}
+					}
+				}
+
+				//	Strings get 8 bytes for their length and are padded to
+				//	keep the next length aligned.
+				constexpr std::uint64_t kLength = sizeof(std::uint64_t);
+				auto Align = [](std::uint64_t n, std::uint64_t to) {
+					return (n + to - 1u) / to * to;
+				};
+				std::uint64_t size =
+					sizeof(SnapshotHeader) + slotCount * sizeof(SnapshotSlot);
+				std::vector<std::uint64_t> offsets;
+				offsets.reserve(unique.size());
+				for(auto key: unique) {
+					if constexpr(kString) {
+						offsets.push_back(size + kLength);
+						size = Align(offsets.back() + Bytes(*key), kLength);
+					}
+					else {
+						offsets.push_back(Align(size, alignof(T)));
+						size = offsets.back() + sizeof(T);
+					}
+				}
+				for(auto& slot: slots) {
+					if(slot.offset) {
+						slot.offset = offsets[slot.offset - 1u];
+					}
+				}
+
+				SnapshotHeader header{};
+				std::memcpy(header.magic, kMagic, sizeof kMagic);
+				header.version = kVersion;
+				header.unit = kUnit;
+				header.check = Check();
+				header.count = unique.size();
+				header.slots = slotCount;
+				header.size = size;
+				out.write(reinterpret_cast<const char*>(&header), sizeof header);
+				out.write(
+					reinterpret_cast<const char*>(slots.data()),
+					static_cast<std::streamsize>(slotCount * sizeof(SnapshotSlot))
+					);
+				std::uint64_t at =
+					sizeof(SnapshotHeader) + slotCount * sizeof(SnapshotSlot);
+				for(std::size_t i = 0; i < unique.size(); ++i) {
+					auto& key = *unique[i];
+					if constexpr(kString) {
+						std::uint64_t n = key.size();
+						Pad(out, offsets[i] - kLength - at);
+						out.write(reinterpret_cast<const char*>(&n), kLength);
+						out.write(
+							reinterpret_cast<const char*>(key.data()),
+							static_cast<std::streamsize>(Bytes(key) - sizeof(key[0]))
+							);
+						Pad(out, sizeof(key[0]));
+					}
+					else {
+						Pad(out, offsets[i] - at);
+						out.write(reinterpret_cast<const char*>(&key), sizeof key);
+					}
+					at = offsets[i] + Bytes(key);
+				}
+				Pad(out, size - at);
+			}
+		};
+
+	//---- Frozen Tables -------------------------------------------------------
+	//
+	//	Frozen<T,Tuple=void,Policy=policy::Default>:
+	//		A Frozen table is an immutable copy of the MakeInterned() table for
+	//		T/Tuple/Policy as it stood at some point, meant for vocabularies
+	//		(tag names, shader keys) that stop changing once a program is up
+	//		and running. It holds a reference to every object that was live at
+	//		the time, filed in one contiguous array of slots by a perfect hash.
+	//		A look-up hashes its args once as usual, goes straight to the one
+	//		slot they could be in, and compares one object. No mutex is taken
+	//		and no weak pointer gets locked, so any number of threads can read
+	//		from a Frozen table at once.
+	//
+	//		Anything not found there falls through to the MakeInterned() table,
+	//		which carries on as the mutable overflow (with the hash passed
+	//		along rather than computed again). The frozen objects are the very
+	//		ones MakeInterned() hands out, so results from either compare equal
+	//		by address, and they stay alive until the Frozen table is gone.
+	//
+	//	Frozen<T,Tuple,Policy>::Freeze() -> Frozen:
+	//		Builds a Frozen table out of the objects currently interned. Those
+	//		interned (or released) while it runs may or may not make it in. Two
+	//		different objects with the same hash value cannot be told apart by
+	//		a perfect hash, so in the unlikely event there are any, they are
+	//		left to the overflow.
+	//
+	//	Frozen<T,Tuple,Policy>::MakeInterned(args...)
+	//	-> std::shared_ptr<const T>:
+	//		Works like intern::MakeInterned(), but looks in the Frozen table
+	//		first. A hit copies the shared pointer it holds.
+	//
+	//	Frozen<T,Tuple,Policy>::Find(args...) -> const T*:
+	//		Looks only in the Frozen table, returning null on a miss. This
+	//		skips even the reference count, so the pointer is only good while
+	//		the Frozen table is.
+	//
+	//	Frozen<T,Tuple,Policy>::size() -> std::size_t:
+	//		Returns the number of objects frozen.
+
+	template<typename T, typename Tuple=void, typename Policy=policy::Default>
+		class Frozen {
+		public:
+			using Result = std::shared_ptr<const T>;
+
+			Frozen() = default;
+
+			static auto Freeze() -> Frozen {
+				std::vector<Item> items;
+				for(auto& shard: TTable::gShards) {
+					//	Dropping a reference under the shard's mutex could
+					//	mean erasing under it too, so nothing that could throw
+					//	(and unwind) is done there. Room for the shard's
+					//	objects is made up front, and any that turn up beyond
+					//	that are left out.
+					items.reserve(items.size() + shard.Census().size);
+					shard.ForEach([&items](auto& entry) {
+						if(items.size() < items.capacity()) {
+							if(auto result = TRef::Acquire(entry)) {
+								items.push_back(
+									Item{entry.Hash(), std::move(result)}
+									);
+							}
+						}
+					});
+				}
+				return Frozen{std::move(items)};
+			}
+
+			template<typename... Args>
+				auto MakeInterned(Args&&... args) const -> Result {
+					auto probe = details::MakeProbe<T,Tuple,Policy>(
+						std::forward<Args>(args)...
+						);
+					auto hash = probe.Hash();
+					if(auto i = Lookup(hash, probe); i != kNone) {
+						return mRefs[i];
+					}
+					return TTable::Intern(hash, probe);
+				}
+			template<typename... Args>
+				auto Find(Args&&... args) const -> const T* {
+					auto probe = details::MakeProbe<T,Tuple,Policy>(
+						std::forward<Args>(args)...
+						);
+					auto i = Lookup(probe.Hash(), probe);
+					return i != kNone ? mSlots[i].value : nullptr;
+				}
+			auto size() const noexcept -> std::size_t {
+				return mCount;
+			}
+
+		private:
+			using TTable = details::Table<T,Tuple,Policy>;
+			using TRef = details::SharedRef<T,Tuple,Policy>;
+
+			struct Item {
+				std::size_t hash;
+				Result object;
+			};
+			struct Slot {
+				std::size_t hash;
+				const T* value;
+			};
+
+			static constexpr std::size_t kNone = ~std::size_t{0};
+
+			//	A bucket gives up on displacements once it has tried this
+			//	many, and the slots are spread out a little more.
+			static constexpr std::uint32_t kMaxDisplace = 1u << 16;
+
+			//	The hash-and-displace scheme: each hash picks one of the
+			//	buckets in mDisplace, and that bucket's displacement d, mixed
+			//	back into the hash, picks the slot. Freezing searches for a
+			//	d per bucket that lands all its objects in empty slots.
+			std::vector<std::uint32_t> mDisplace;
+			std::vector<Slot> mSlots;
+			std::vector<Result> mRefs;  // parallel to mSlots
+			std::size_t mCount = 0;
+
+			explicit Frozen(std::vector<Item> items) {
+				//	Objects sharing a hash with another go to the overflow.
+				std::sort(
+					items.begin(), items.end(),
+					[](const Item& a, const Item& b) { return a.hash < b.hash; }
+					);
+				std::size_t n = 0;
+				for(std::size_t i = 0, j; i < items.size(); i = j) {
+					for(j = i + 1;
+						j < items.size() && items[j].hash == items[i].hash;
+						++j) {}
+					if(j == i + 1) {
+						items[n++] = std::move(items[i]);
+					}
+				}
+				items.erase(items.begin() + n, items.end());
+				if(n == 0) {
+					return;
+				}
+				if(n > std::numeric_limits<std::uint32_t>::max() / 2u) {
+					throw std::length_error{"too many objects to freeze"};
+				}
+
+				//	About 4 objects to a bucket and 8/9 of the slots full.
+				auto slotCount = n + n / 8u + 1u;
+				while(!Place(items, n / 4u + 1u, slotCount)) {
+					slotCount += n / 8u + 1u;
+				}
+				mCount = n;
+			}
+
+			//	Place() tries to find displacements for the given numbers of
+			//	buckets and slots, filling in the table if it succeeds.
+			auto Place(
+				std::vector<Item>& items,
+				std::size_t bucketCount, std::size_t slotCount
+				) -> bool
+			{
+				//	Group the items by bucket with a counting sort, and place
+				//	the biggest buckets first while the slots are emptiest.
+				std::vector<std::size_t> starts(bucketCount + 1u);
+				for(auto& item: items) {
+					++starts[Bucket(item.hash, bucketCount) + 1u];
+				}
+				for(std::size_t b = 0; b < bucketCount; ++b) {
+					starts[b + 1u] += starts[b];
+				}
+				std::vector<std::size_t> members(items.size());
+				auto ends = starts;
+				for(std::size_t k = 0; k < items.size(); ++k) {
+					members[ends[Bucket(items[k].hash, bucketCount)]++] = k;
+				}
+				std::vector<std::size_t> order(bucketCount);
+				for(std::size_t b = 0; b < bucketCount; ++b) {
+					order[b] = b;
+				}
+				std::stable_sort(
+					order.begin(), order.end(),
+					[&starts](std::size_t a, std::size_t b) {
+						return starts[a + 1u] - starts[a] >
+							starts[b + 1u] - starts[b];
+					});
+
+				std::vector<std::uint32_t> displace(bucketCount);
+				std::vector<std::size_t> owners(slotCount, kNone);
+				std::vector<std::size_t> spots;
+				for(auto b: order) {
+					auto first = members.data() + starts[b];
+					auto last = members.data() + starts[b + 1u];
+					if(first == last) {
+						break;
+					}
+					for(std::uint32_t d = 0;; ++d) {
+						if(d == kMaxDisplace) {
+							return false;
+						}
+						spots.clear();
+						for(auto p = first; p != last; ++p) {
+							auto i = SlotIndex(items[*p].hash, d, slotCount);
+							if(	owners[i] != kNone ||
+								std::find(spots.begin(), spots.end(), i) !=
+									spots.end())
+							{
+								break;
+							}
+							spots.push_back(i);
+						}
+						if(spots.size() == std::size_t(last - first)) {
+							for(std::size_t m = 0; m < spots.size(); ++m) {
+								owners[spots[m]] = first[m];
+							}
+							displace[b] = d;
+							break;
+						}
+					}
+				}
+
+				mDisplace = std::move(displace);
+				mSlots.assign(slotCount, Slot{0, nullptr});
+				mRefs.assign(slotCount, Result{});
+				for(std::size_t i = 0; i < slotCount; ++i) {
+					if(auto k = owners[i]; k != kNone) {
+						mSlots[i] = Slot{items[k].hash, items[k].object.get()};
+						mRefs[i] = std::move(items[k].object);
+					}
+				}
+				return true;
+			}
+
+			template<typename Probe>
+				auto Lookup(std::size_t hash, const Probe& probe) const
+					-> std::size_t
+				{
+					if(mCount == 0) {
+						return kNone;
+					}
+					auto d = mDisplace[Bucket(hash, mDisplace.size())];
+					auto i = SlotIndex(hash, d, mSlots.size());
+					auto& slot = mSlots[i];
+					return slot.value && slot.hash == hash &&
+						probe.Matches(*slot.value) ? i : kNone;
+				}
+
+			//	Mix() is the 64-bit finalizer from MurmurHash3. Reduce() maps
+			//	its top 32 bits onto [0, n) with a multiply rather than a
+			//	divide.
+			static auto Mix(std::uint64_t x) -> std::uint64_t {
+				x ^= x >> 33;
+				x *= 0xff51afd7ed558ccd;
+				x ^= x >> 33;
+				x *= 0xc4ceb9fe1a85ec53;
+				x ^= x >> 33;
+				return x;
+			}
+			static auto Reduce(std::uint64_t x, std::size_t n) -> std::size_t {
+				return static_cast<std::size_t>(((x >> 32) * n) >> 32);
+			}
+			static auto Bucket(std::size_t hash, std::size_t n)
+				-> std::size_t
+			{
+				return Reduce(Mix(hash), n);
+			}
+			static auto SlotIndex(
+				std::size_t hash, std::uint32_t d, std::size_t n
+				) -> std::size_t
+			{
+				return Reduce(
+					Mix(hash + (std::uint64_t{d} + 1u) * 0x9e3779b97f4a7c15),
+					n
+					);
+			}
+		};
+
+	//---- Symbols -------------------------------------------------------------
+	//
+	//	BasicSymbol<Char=char,Policy=policy::Default>:
+	//	Symbol:
+	//		A Symbol is an interned string pared down to a single pointer. It
+	//		is built from anything convertible to a std::basic_string_view of
+	//		Char, which is looked up as is, without allocating. The first time
+	//		a string turns up, its characters are copied into an append-only
+	//		arena, after their length and followed by a null. Every Symbol for
+	//		that string then points there, so comparing two is a pointer
+	//		compare, and size() and c_str() are just as quick as on a
+	//		std::string. (std::hash is specialized to hash the pointer.)
+	//
+	//		Where MakeInterned<std::string>() spends a std::string, a table
+	//		node, a control block, and often a heap buffer on each string, a
+	//		Symbol's string costs its characters plus a null and an 8-byte
+	//		length, rounded up to a multiple of 8, plus a 16-byte slot in a
+	//		hash table no more than 7/8 full. In exchange, nothing is ever
+	//		freed: the arenas live until the program ends, so Symbols suit
+	//		vocabularies (names, tags, keys) more than arbitrary text.
+	//
+	//		A default-constructed Symbol is the empty string, as is one built
+	//		from an empty one. These take no memory. Symbols live in tables of
+	//		their own, apart from MakeInterned(). Of the Policy settings, only
+	//		kShards, kMaxLoad, Hasher, and kThreadSafe apply. Symbol is short
+	//		for BasicSymbol<char>.
+	//
+	//	BasicSymbol<Char,Policy>::Find(s) -> BasicSymbol:
+	//		Returns the Symbol for s if there is one already, or else an empty
+	//		Symbol.
+	//
+	//	BasicSymbol<Char,Policy>::Reserve(n):
+	//	BasicSymbol<Char,Policy>::Stats() -> TableStats:
+	//		Like intern::Reserve() and intern::Stats() for the Symbol table.
+	//		bytes includes the arenas, and no events are counted.
+
+	namespace details {
+
+		//	A SymbolShard is one shard of the table behind BasicSymbol: an
+		//	arena plus an array of slots, probed linearly, in which an empty
+		//	slot has null chars. The arena grows by whole chunks, except that
+		//	a long string gets a chunk to itself. In the arena, each string's
+		//	length sits in front of its characters, which are padded out to
+		//	keep the next length aligned.
+		template<typename Char, typename Policy>
+			struct alignas(kCacheLine) SymbolShard {
+				using View = std::basic_string_view<Char>;
+				using Unit = std::uint64_t;
+				struct Slot {
+					std::size_t hash;
+					const Char* chars;
+				};
+
+				static constexpr std::size_t kChunkUnits = 8192;  // 64 KiB
+
+				TMutex<Policy> mutex;
+				std::vector<Slot> slots;
+				std::size_t size = 0;
+				std::vector<std::unique_ptr<Unit[]>> chunks;
+				Unit* next = nullptr;
+				std::size_t unitsLeft = 0;
+				std::size_t arenaBytes = 0;
+
+				static auto Length(const Char* chars) -> std::size_t {
+					Unit n;
+					std::memcpy(
+						&n, reinterpret_cast<const unsigned char*>(chars) -
+							sizeof n,
+						sizeof n
+						);
+					return static_cast<std::size_t>(n);
+				}
+
+				auto Intern(std::size_t hash, View s) -> const Char* {
+					std::lock_guard<TMutex<Policy>> lg{mutex};
+					if(auto chars = Lookup(hash, s)) {
+						return chars;
+					}
+					if(size >= MaxFill(slots.size())) {
+						Rehash(std::max<std::size_t>(16, 2 * slots.size()));
+					}
+					auto chars = Store(s);
+					Place(Slot{hash, chars});
+					++size;
+					return chars;
+				}
+				auto Find(std::size_t hash, View s) -> const Char* {
+					std::lock_guard<TMutex<Policy>> lg{mutex};
+					return Lookup(hash, s);
+				}
+				void Reserve(std::size_t n) {
+					std::lock_guard<TMutex<Policy>> lg{mutex};
+					if(n > MaxFill(slots.size())) {
+						auto capacity = std::max<std::size_t>(16, slots.size());
+						while(MaxFill(capacity) < n) {
+							capacity <<= 1;
+						}
+						Rehash(capacity);
+					}
+				}
+				auto Census() -> ShardCensus {
+					std::lock_guard<TMutex<Policy>> lg{mutex};
+					ShardCensus census;
+					census.size = size;
+					census.capacity = slots.size();
+					census.bytes = sizeof *this +
+						slots.size() * sizeof(Slot) + arenaBytes;
+					CountWaits(mutex, census);
+					return census;
+				}
+
+			private:
+				static constexpr auto MaxFill(std::size_t capacity)
+					-> std::size_t
+				{
+					if constexpr(Policy::kMaxLoad != 0) {
+						return capacity * Policy::kMaxLoad / 100u;
+					}
+					else {
+						return capacity - capacity / 8u;
+					}
+				}
+
+				auto Lookup(std::size_t hash, View s) const -> const Char* {
+					if(slots.empty()) {
+						return nullptr;
+					}
+					auto mask = slots.size() - 1u;
+					for(auto i = hash & mask;; i = (i + 1u) & mask) {
+						auto& slot = slots[i];
+						if(!slot.chars) {
+							return nullptr;
+						}
+						if(	slot.hash == hash &&
+							Length(slot.chars) == s.size() &&
+							std::char_traits<Char>::compare(
+								slot.chars, s.data(), s.size()
+								) == 0)
+						{
+							return slot.chars;
+						}
+					}
+				}
+				void Place(const Slot& slot) {
+					auto mask = slots.size() - 1u;
+					auto i = slot.hash & mask;
+					while(slots[i].chars) {
+						i = (i + 1u) & mask;
+					}
+					slots[i] = slot;
+				}
+				void Rehash(std::size_t capacity) {
+					auto old = std::exchange(
+						slots, std::vector<Slot>(capacity, Slot{0, nullptr})
+						);
+					for(auto& slot: old) {
+						if(slot.chars) {
+							Place(slot);
+						}
+					}
+				}
+
+				//	Store() copies s into the arena and returns the copy.
+				auto Store(View s) -> const Char* {
+					auto n = s.size();
+					auto units = 1u +
+						((n + 1u) * sizeof(Char) + sizeof(Unit) - 1u) /
+						sizeof(Unit);
+					Unit* p;
+					if(units > kChunkUnits / 4u) {
+						p = NewChunk(units);
+					}
+					else {
+						if(units > unitsLeft) {
+							next = NewChunk(kChunkUnits);
+							unitsLeft = kChunkUnits;
+						}
+						p = next;
+						next += units;
+						unitsLeft -= units;
+					}
+					*p = n;
+					auto chars = reinterpret_cast<Char*>(p + 1);
+					std::uninitialized_copy_n(s.data(), n, chars);
+					::new(static_cast<void*>(chars + n)) Char{};
+					return chars;
+				}
+				auto NewChunk(std::size_t units) -> Unit* {
+					chunks.emplace_back(new Unit[units]);
+					arenaBytes += units * sizeof(Unit);
+					return chunks.back().get();
+				}
+			};
+	}
+
+	template<typename Char=char, typename Policy=policy::Default>
+		class BasicSymbol {
+		public:
+			using View = std::basic_string_view<Char>;
+
+			BasicSymbol() noexcept = default;
+			explicit BasicSymbol(View s) {
+				if(!s.empty()) {
+					auto hash = Hash(s);
+					mChars = ShardFor(hash).Intern(hash, s);
+				}
+			}
+
+			static auto Find(View s) -> BasicSymbol {
+				BasicSymbol symbol;
+				if(!s.empty()) {
+					auto hash = Hash(s);
+					symbol.mChars = ShardFor(hash).Find(hash, s);
+				}
+				return symbol;
+			}
+			static void Reserve(std::size_t n) {
+				auto share = (n + kShards - 1) / kShards;
+				if constexpr(kShards > 1) {
+					share += share / 8u;
+				}
+				for(auto& shard: Shards()) {
+					shard.Reserve(share);
+				}
+			}
+			static auto Stats() -> TableStats {
+				TableStats stats;
+				stats.shardSizes.resize(kShards);
+				for(std::size_t i = 0; i < kShards; ++i) {
+					auto census = Shards()[i].Census();
+					stats.live += census.size;
+					stats.capacity += census.capacity;
+					stats.bytes += census.bytes;
+					stats.lockWaits += census.lockWaits;
+					stats.lockWaitTime +=
+						std::chrono::nanoseconds{census.lockWaitNs};
+					stats.shardSizes[i] = census.size;
+				}
+				return stats;
+			}
+
+			auto data() const noexcept -> const Char* {
+				return mChars ? mChars : kEmpty;
+			}
+			auto c_str() const noexcept -> const Char* {
+				return data();
+			}
+			auto size() const noexcept -> std::size_t {
+				return mChars ? Shard::Length(mChars) : 0;
+			}
+			auto length() const noexcept -> std::size_t {
+				return size();
+			}
+			auto empty() const noexcept -> bool {
+				return !mChars;
+			}
+			auto view() const noexcept -> View {
+				return View{data(), size()};
+			}
+			operator View () const noexcept {
+				return view();
+			}
+
+			friend auto operator == (BasicSymbol a, BasicSymbol b) noexcept {
+				return a.mChars == b.mChars;
+			}
+			friend auto operator != (BasicSymbol a, BasicSymbol b) noexcept {
+				return a.mChars != b.mChars;
+			}
+
+		private:
+			using Shard = details::SymbolShard<Char,Policy>;
+
+			static constexpr std::size_t kShards = Policy::kShards;
+			static constexpr Char kEmpty[1] = {};
+
+			const Char* mChars = nullptr;
+
+			static auto Hash(View s) -> std::size_t {
+				return Policy::Hasher::HashBytes(
+					s.data(), s.size() * sizeof(Char)
+					);
+			}
+
+			//	The shards are leaked, like StatsBook::Registry(), so that
+			//	Symbols stay good through static destruction.
+			static auto Shards() -> std::array<Shard,kShards>& {
+				static auto& shards = *new std::array<Shard,kShards>;
+				return shards;
+			}
+
+			//	Shards are picked by the top bits of a Fibonacci hash, as in
+			//	Table, leaving the low bits for the slots.
+			static auto ShardFor(std::size_t hash) -> Shard& {
+				if constexpr(kShards == 1) {
+					return Shards()[0];
+				}
+				else {
+					constexpr std::size_t kMagic =
+						sizeof(std::size_t) * CHAR_BIT > 32u ?
+						0x9e3779b97f4a7c15 : 0x9e3779b9;
+					constexpr int kShift = [] {
+						int shift = sizeof(std::size_t) * CHAR_BIT;
+						for(auto n = kShards; n > 1; n >>= 1) {
+							--shift;
+						}
+						return shift;
+					}();
+					return Shards()[(hash * kMagic) >> kShift];
+				}
+			}
+		};
+
+	using Symbol = BasicSymbol<>;
+}
+
+namespace std {
+	template<typename T, typename Tuple, typename Policy>
+		struct hash<intern::Handle<T,Tuple,Policy>> {
+			auto operator () (const intern::Handle<T,Tuple,Policy>& h)
+				const noexcept -> std::size_t
+			{
+				if constexpr(Policy::kCompact) {
+					return hash<const T*>{}(h.get());
+				}
+				else {
+					return h.hash();
+				}
+			}
+		};
+	template<typename T, typename Tuple, typename Policy>
+		struct hash<intern::Id<T,Tuple,Policy>> {
+			auto operator () (intern::Id<T,Tuple,Policy> id) const noexcept
+				-> std::size_t
+			{
+				return id.value();
+			}
+		};
+	template<typename Char, typename Policy>
+		struct hash<intern::BasicSymbol<Char,Policy>> {
+			auto operator () (intern::BasicSymbol<Char,Policy> s)
+				const noexcept -> std::size_t
+			{
+				return std::hash<const Char*>{}(s.data());
+			}
+		};
 }
@@ -0,0 +1,341 @@
+/*
+	_intern is an optional compiled backend for intern.py and internable.py.
+	It provides the same Table class as the pure-Python one in intern.py
+	(see _details.Table), and both modules pick it up automatically when it
+	has been built (see setup.py). Otherwise, they fall back to Python.
+
+	The design follows the C++ MakeInterned() table. Objects are filed under
+	hashable keys (the KeyTuple() of each object) in a dict whose values are
+	weak references, so that the table never keeps an object alive. A
+	look-up that finds an entry whose object has died treats it as a miss
+	and replaces it. And an entry is only ever removed once the object it
+	refers to is going away, so that a duplicate being discarded cannot
+	unregister the interned original.
+
+	Where the C++ table holds a shard mutex, this relies on the GIL: no
+	Python code runs between looking an entry up and storing a new one,
+	except for whatever __hash__ and __eq__ the key elements define.
+*/
+
+#define PY_SSIZE_T_CLEAN
+#include <Python.h>
+
+static PyObject* gAstuple;  // interned "astuple"
+
+//	GetRef() returns a new reference to ref's object, or NULL (without an
+//	exception) if it has died.
+static PyObject* GetRef(PyObject* ref) {
+ #if PY_VERSION_HEX >= 0x030D0000
+	PyObject* obj;
+	if(PyWeakref_GetRef(ref, &obj) < 0) {
+		PyErr_Clear();
+		return NULL;
+	}
+	return obj;
+ #else
+	PyObject* obj = PyWeakref_GetObject(ref);
+	if(obj == NULL) {
+		PyErr_Clear();
+		return NULL;
+	}
+	if(obj == Py_None) {
+		return NULL;
+	}
+	Py_INCREF(obj);
+	return obj;
+ #endif
+}
+
+//	IsScalar() tells whether obj is of a built-in type with no astuple()
+//	method, whose KeyTuple() as an element is simply (obj, type). These
+//	are by far the most common elements, so they skip the failed astuple
+//	look-up, which would raise and discard an AttributeError each time.
+static int IsScalar(PyObject* obj) {
+	return obj == Py_None || PyBool_Check(obj) || PyLong_CheckExact(obj) ||
+		PyFloat_CheckExact(obj) || PyUnicode_CheckExact(obj) ||
+		PyBytes_CheckExact(obj) || PyComplex_CheckExact(obj);
+}
+
+static PyObject* KeyTuple(PyObject* obj, int recursing);
+
+//	PackKey() returns a tuple of the KeyTuple() of each element of seq,
+//	followed by typ, like makeTuple() in _details.KeyTuple(). The elements
+//	are copied into a tuple of their own first, since the recursive calls
+//	can run arbitrary Python code (astuple(), __hash__) that might resize a
+//	list out from under us.
+static PyObject* PackKey(PyObject* seq, PyObject* typ) {
+	PyObject* elems = PySequence_Tuple(seq);
+	if(elems == NULL) {
+		return NULL;
+	}
+	Py_ssize_t n = PyTuple_GET_SIZE(elems);
+	PyObject* key = PyTuple_New(n + 1);
+	if(key == NULL) {
+		Py_DECREF(elems);
+		return NULL;
+	}
+	for(Py_ssize_t i = 0; i < n; ++i) {
+		PyObject* elem = KeyTuple(PyTuple_GET_ITEM(elems, i), 1);
+		if(elem == NULL) {
+			Py_DECREF(key);
+			Py_DECREF(elems);
+			return NULL;
+		}
+		PyTuple_SET_ITEM(key, i, elem);
+	}
+	Py_INCREF(typ);
+	PyTuple_SET_ITEM(key, n, typ);
+	Py_DECREF(elems);
+	return key;
+}
+
+//	PackDict() handles dicts, which are keyed by their items() as
+//	(key, value) tuples.
+static PyObject* PackDict(PyObject* dct) {
+	PyObject* items = PyTuple_New(PyDict_Size(dct));
+	if(items == NULL) {
+		return NULL;
+	}
+	Py_ssize_t pos = 0, i = 0;
+	PyObject *k, *v;
+	while(PyDict_Next(dct, &pos, &k, &v)) {
+		PyObject* item = PyTuple_Pack(2, k, v);
+		if(item == NULL) {
+			Py_DECREF(items);
+			return NULL;
+		}
+		PyTuple_SET_ITEM(items, i++, item);
+	}
+	PyObject* key = PackKey(items, (PyObject*)&PyDict_Type);
+	Py_DECREF(items);
+	return key;
+}
+
+//	KeyTuple() mirrors _details.KeyTuple() in intern.py.
+static PyObject* KeyTuple(PyObject* obj, int recursing) {
+	PyObject* typ = (PyObject*)Py_TYPE(obj);
+	if(recursing && IsScalar(obj)) {
+		return PyTuple_Pack(2, obj, typ);
+	}
+	if(Py_EnterRecursiveCall(" in intern KeyTuple()")) {
+		return NULL;
+	}
+	PyObject* key;
+	PyObject* tup = PyObject_CallMethodObjArgs(obj, gAstuple, NULL);
+	if(tup != NULL) {
+		key = PackKey(tup, typ);
+		Py_DECREF(tup);
+	}
+	else if(!PyErr_ExceptionMatches(PyExc_AttributeError)) {
+		key = NULL;
+	}
+	else {
+		PyErr_Clear();
+		if(PyList_CheckExact(obj) || PyTuple_CheckExact(obj)) {
+			key = PackKey(obj, typ);
+		}
+		else if(PyDict_CheckExact(obj)) {
+			key = PackDict(obj);
+		}
+		else if(recursing) {
+			key = PyTuple_Pack(2, obj, typ);
+		}
+		else {
+			PyObject* ref = PyWeakref_NewRef(obj, NULL);
+			key = ref ? PyTuple_Pack(2, ref, typ) : NULL;
+			Py_XDECREF(ref);
+		}
+	}
+	Py_LeaveRecursiveCall();
+	return key;
+}
+
+//---- Table -------------------------------------------------------------------
+
+typedef struct {
+	PyObject_HEAD
+	PyObject* dict;  // KeyTuple() -> weakref to the interned object
+} Table;
+
+static int Table_init(Table* self, PyObject* args, PyObject* kwargs) {
+	static char* kwlist[] = {NULL};
+	if(!PyArg_ParseTupleAndKeywords(args, kwargs, ":Table", kwlist)) {
+		return -1;
+	}
+	PyObject* dict = PyDict_New();
+	if(dict == NULL) {
+		return -1;
+	}
+	Py_XSETREF(self->dict, dict);
+	return 0;
+}
+
+//	Keys hold on to their objects' classes, which hold on to their tables,
+//	so a Table takes part in garbage collection.
+static int Table_traverse(Table* self, visitproc visit, void* arg) {
+	Py_VISIT(self->dict);
+	return 0;
+}
+static int Table_clear(Table* self) {
+	Py_CLEAR(self->dict);
+	return 0;
+}
+static void Table_dealloc(Table* self) {
+	PyObject_GC_UnTrack(self);
+	Table_clear(self);
+	Py_TYPE(self)->tp_free((PyObject*)self);
+}
+
+//	Lookup() returns a new reference to the live object filed under key,
+//	or NULL, with an exception only if the look-up itself failed.
+static PyObject* Lookup(Table* self, PyObject* key) {
+	if(self->dict == NULL) {
+		PyErr_SetString(PyExc_ValueError, "Table has been cleared");
+		return NULL;
+	}
+	PyObject* ref = PyDict_GetItemWithError(self->dict, key);
+	return ref ? GetRef(ref) : NULL;
+}
+
+static PyObject* Table_register(Table* self, PyObject* obj) {
+	PyObject* key = KeyTuple(obj, 0);
+	if(key == NULL) {
+		return NULL;
+	}
+	PyObject* found = Lookup(self, key);
+	if(found == NULL && !PyErr_Occurred()) {
+		PyObject* ref = PyWeakref_NewRef(obj, NULL);
+		if(ref != NULL) {
+
+			//	setdefault() rather than a plain store, in case a key's
+			//	__eq__ let another thread in since the look-up. A dead entry
+			//	it turns up is replaced.
+			PyObject* old = PyDict_SetDefault(self->dict, key, ref);
+			if(old == ref) {
+				Py_INCREF(obj);
+				found = obj;
+			}
+			else if(old != NULL && (found = GetRef(old)) == NULL) {
+				if(PyDict_SetItem(self->dict, key, ref) == 0) {
+					Py_INCREF(obj);
+					found = obj;
+				}
+			}
+			Py_DECREF(ref);
+		}
+	}
+	Py_DECREF(key);
+	return found;
+}
+
+static PyObject* Table_unregister(Table* self, PyObject* obj) {
+	PyObject* key = KeyTuple(obj, 0);
+	if(key == NULL) {
+		return NULL;
+	}
+	PyObject* found = Lookup(self, key);
+	int rc = 0;
+	if(found == obj || (found == NULL && !PyErr_Occurred())) {
+		rc = PyDict_DelItem(self->dict, key);
+		if(rc < 0 && PyErr_ExceptionMatches(PyExc_KeyError)) {
+			PyErr_Clear();
+			rc = 0;
+		}
+	}
+	else if(found == NULL) {
+		rc = -1;
+	}
+	Py_XDECREF(found);
+	Py_DECREF(key);
+	if(rc < 0) {
+		return NULL;
+	}
+	Py_RETURN_NONE;
+}
+
+static PyObject* Table_contains(Table* self, PyObject* obj) {
+	PyObject* key = KeyTuple(obj, 0);
+	if(key == NULL) {
+		return NULL;
+	}
+	PyObject* found = Lookup(self, key);
+	Py_DECREF(key);
+	if(found == NULL && PyErr_Occurred()) {
+		return NULL;
+	}
+	Py_XDECREF(found);
+	return PyBool_FromLong(found == obj);
+}
+
+static Py_ssize_t Table_len(Table* self) {
+	return self->dict ? PyDict_Size(self->dict) : 0;
+}
+
+static PyMethodDef Table_methods[] = {
+	{"register", (PyCFunction)Table_register, METH_O,
+		"register(obj) -> obj or its interned equivalent"},
+	{"unregister", (PyCFunction)Table_unregister, METH_O,
+		"unregister(obj): removes obj's entry if obj is the one interned"},
+	{"contains", (PyCFunction)Table_contains, METH_O,
+		"contains(obj) -> True if obj is the object interned for its key"},
+	{NULL, NULL, 0, NULL}
+};
+
+static PySequenceMethods Table_as_sequence = {
+	.sq_length = (lenfunc)Table_len,
+};
+
+static PyTypeObject TableType = {
+	PyVarObject_HEAD_INIT(NULL, 0)
+	.tp_name = "intern._intern.Table",
+	.tp_doc = "An internment table of weak references keyed by KeyTuple().",
+	.tp_basicsize = sizeof(Table),
+	.tp_flags = Py_TPFLAGS_DEFAULT | Py_TPFLAGS_HAVE_GC,
+	.tp_new = PyType_GenericNew,
+	.tp_init = (initproc)Table_init,
+	.tp_dealloc = (destructor)Table_dealloc,
+	.tp_traverse = (traverseproc)Table_traverse,
+	.tp_clear = (inquiry)Table_clear,
+	.tp_methods = Table_methods,
+	.tp_as_sequence = &Table_as_sequence,
+};
+
+//---- Module ------------------------------------------------------------------
+
+static PyObject* KeyTupleFunc(PyObject* module, PyObject* obj) {
+	(void)module;
+	return KeyTuple(obj, 0);
+}
+
+static PyMethodDef methods[] = {
+	{"KeyTuple", KeyTupleFunc, METH_O,
+		"KeyTuple(obj) -> tuple, as _details.KeyTuple() in intern.py"},
+	{NULL, NULL, 0, NULL}
+};
+
+static struct PyModuleDef module = {
+	PyModuleDef_HEAD_INIT, "_intern",
+	"Compiled backend for intern.py and internable.py.", -1, methods,
+	NULL, NULL, NULL, NULL
+};
+
+PyMODINIT_FUNC PyInit__intern(void) {
+	if(PyType_Ready(&TableType) < 0) {
+		return NULL;
+	}
+	gAstuple = PyUnicode_InternFromString("astuple");
+	if(gAstuple == NULL) {
+		return NULL;
+	}
+	PyObject* m = PyModule_Create(&module);
+	if(m == NULL) {
+		return NULL;
+	}
+	Py_INCREF(&TableType);
+	if(PyModule_AddObject(m, "Table", (PyObject*)&TableType) < 0) {
+		Py_DECREF(&TableType);
+		Py_DECREF(m);
+		return NULL;
+	}
+	return m;
+}
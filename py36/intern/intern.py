@@ -3,6 +3,13 @@ from typing import Any, ClassVar, Generator, Optional, Union
 from weakref import ref, ReferenceType
 from threading import Lock
 
+#	The compiled backend is optional (see setup.py). Without it, everything
+#	runs in pure Python.
+try:
+	from . import _intern
+except ImportError:
+	_intern = None
+
 class _details:
 	#	A class used as a namespace to hide implementation details.
 
@@ -69,58 +76,86 @@ class _details:
 			#	call), we want to tack on the object's data type (see note
 			#	under genElems() regarding this).
 			return makeTuple(tup, typ)
-	@classmethod
-	def RegisterObj(cls, lock: Lock, dct: dict, obj: Any) -> Any:
-		#	Looks up whether a particular object has already been interned.
-		#	If so, the previously interned object is returned. Otherwise, the
-		#	input object is returned once it has been installed in the
-		#	internment dictionary.
-		#
-		#	Args:
-		#		lock: used to manage access to dct (which should be a global)
-		#		dct: the internment dictionary
-		#			Maps key tuples onto weak references to interned objects.
-		#		obj: the object to register
+	class Table:
+		#	Table is the pure-Python internment table, used whenever the
+		#	compiled _intern module (see _intern.c) is unavailable. The two
+		#	have the same interface and behaviour, and NewTable() below picks
+		#	whichever is at hand.
 		#
-		#	Returns: either the input obj or a previously interned equivalent
-
-		#	Get the object data in tuple form.
-		tup = cls.KeyTuple(obj)
-
-		with lock:
-
-			#	Return the interned object, if any, whose key matches the tuple.
-			try:
-				return dct[tup]()
-
-			#	If the object has yet to be interned, we intern it by adding a
-			#	new item to the dictionary. The tuple serves as the key and a
-			#	weak reference to the object serves as the value. (Weak
-			#	references are appropriate because we do not want the object
-			#	to live on after all references outside the internment dict
-			#	have expired. In fact, we want the object's __del__() method
-			#	to remove it from the dict at that point.)
-			except KeyError:
-				dct[tup] = ref(obj)
-				return obj
+		#	A table maps key tuples (see KeyTuple()) onto weak references to
+		#	interned objects. (Weak references are appropriate because we do
+		#	not want an object to live on after all references outside the
+		#	table have expired. In fact, we want the object's __del__() method
+		#	to remove it from the table at that point.)
+
+		def __init__(self):
+			self.__lock = Lock()
+			self.__dict = {}
+
+		def register(self, obj: Any) -> Any:
+			#	Looks up whether a particular object has already been interned.
+			#	If so, the previously interned object is returned. Otherwise,
+			#	the input object is returned once it has been installed in the
+			#	table.
+			#
+			#	Args:
+			#		obj: the object to register
+			#
+			#	Returns: either the input obj or a previously interned
+			#		equivalent
+
+			#	Get the object data in tuple form.
+			tup = _details.KeyTuple(obj)
+
+			with self.__lock:
+
+				#	Return the interned object, if any, whose key matches the
+				#	tuple. An entry whose object has died (and is only waiting
+				#	for its __del__() to remove it) counts as a miss, and gets
+				#	replaced.
+				wref = self.__dict.get(tup)
+				found = wref() if wref else None
+				if found is None:
+					self.__dict[tup] = ref(obj)
+					found = obj
+				return found
+
+		def unregister(self, obj: Any):
+			#	This method should get called by the __del__() methods of
+			#	interned objects. It removes the table entry corresponding to
+			#	the object.
+			#
+			#	Args:
+			#		obj: the object to remove
+			tup = _details.KeyTuple(obj)
+			with self.__lock:
+
+				#	With Internable objects, it's optional to intern but
+				#	__del__() will still try to unregister them. So we can't
+				#	assume the object will always be there. Nor can we assume
+				#	the entry is obj's, since discarding a duplicate of an
+				#	interned object must leave the original in place.
+				wref = self.__dict.get(tup)
+				if wref is not None:
+					found = wref()
+					if found is None or found is obj:
+						del self.__dict[tup]
+
+		def contains(self, obj: Any) -> bool:
+			#	Returns True if obj is the object interned under its key.
+			tup = _details.KeyTuple(obj)
+			with self.__lock:
+				wref = self.__dict.get(tup)
+				return wref is not None and wref() is obj
+
+		def __len__(self) -> int:
+			return len(self.__dict)
+
 	@classmethod
-	def UnregisterObj(cls, lock: Lock, dct: dict, obj: Any):
-		#	This method should get called by the __del__() methods of objects
-		#	interned in a given dictionary. It removes the dict entry
-		#	corresponding to the object.
-		#
-		#	Args:
-		#		lock: used to manage access to dct (which should be a global)
-		#		dct: the internment dictionary
-		#		obj: the object to remove from dct
-		tup = cls.KeyTuple(obj)
-		with lock:
-
-			#	With Internable objects, it's optional to intern but __del__()
-			#	will still try to unregister them. So we can't assume the object
-			#	will always be there -- hence, the non-exception-throwing pop()
-			#	call here.
-			dct.pop(tup, None)
+	def NewTable(cls):
+		#	Returns a new internment table from the compiled _intern module if
+		#	it has been built, or else a pure-Python Table.
+		return _intern.Table() if _intern else cls.Table()
 
 def Intern(baseCls, *args, **kwargs):
 	"""
@@ -129,15 +164,14 @@ def Intern(baseCls, *args, **kwargs):
 	"""
 
 	class Interned(baseCls):
-		__gLock: ClassVar = Lock()
-		__gDict: ClassVar[dict] = {}
+		__gTable: ClassVar = _details.NewTable()
 
 		def __new__(cls, *args, **kwargs):
 			recurse = kwargs.pop("INTERN_RECURSE", True)
 			if recurse:
 				kwargs["INTERN_RECURSE"] = False
 				obj = cls(*args, **kwargs)
-				return _details.RegisterObj(cls.__gLock, cls.__gDict, obj)
+				return cls.__gTable.register(obj)
 			else:
 				obj = super().__new__(cls)
 			return obj
@@ -145,7 +179,7 @@ def Intern(baseCls, *args, **kwargs):
 			kwargs.pop("INTERN_RECURSE", None)
 			super().__init__(*args, **kwargs)
 		def __del__(self):
-			_details.UnregisterObj(self.__gLock, self.__gDict, self)
+			self.__gTable.unregister(self)
 			try: super().__del__()
 			except AttributeError: pass
 
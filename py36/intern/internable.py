@@ -1,6 +1,5 @@
 from .intern import _details
-from typing import ClassVar, Union
-from threading import Lock
+from typing import ClassVar
 
 class Internable:
 	"""
@@ -12,8 +11,7 @@ class Internable:
 
 	class Immutable(Exception): pass
 
-	__gLock: ClassVar[Lock] = Lock()
-	__gDict: ClassVar[dict] = {}
+	__gTable: ClassVar = _details.NewTable()
 
 	@classmethod
 	def MakeInterned(cls, *args, **kwargs):
@@ -32,7 +30,7 @@ class Internable:
 				already been deallocated).
 		"""
 		obj = cls(*args, **kwargs)
-		return _details.RegisterObj(cls.__gLock, cls.__gDict, obj)
+		return cls.__gTable.register(obj)
 	@classmethod
 	def MakeInternable(cls, *args, **kwargs):
 		"""
@@ -67,9 +65,7 @@ class Internable:
 			True if the current object was allocated by MakeInterned().
 			False if it was instantiated directly.
 		"""
-		tup = _details.KeyTuple(self)
-		with self.__gLock:
-			return tup in self.__gDict
+		return self.__gTable.contains(self)
 	def assertMutable(self):
 		"""
 		It is a good idea to call this from any setter methods.
@@ -84,5 +80,5 @@ class Internable:
 		This custom __del__() method unregisters any interned object from the
 		internal dict global once the last reference to it expires.
 		"""
-		_details.UnregisterObj(self.__gLock, self.__gDict, self)
+		self.__gTable.unregister(self)
 
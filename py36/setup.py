@@ -0,0 +1,20 @@
+#!/usr/bin/env python3
+
+#	Builds the optional compiled backend, intern/_intern.c, which intern.py
+#	and internable.py use automatically once it is importable. To build it in
+#	place, run:
+#
+#		python3 setup.py build_ext --inplace
+#
+#	If there is no C compiler, the build is skipped and the pure-Python
+#	implementation is used instead.
+
+from setuptools import Extension, setup
+
+setup(
+	name="intern",
+	packages=["intern"],
+	ext_modules=[
+		Extension("intern._intern", ["intern/_intern.c"], optional=True),
+	],
+)